@@ -0,0 +1,334 @@
+//
+// Created by Cooper Stevens on 3/15/25.
+//
+
+// microbenchmarks for the hot paths: filling triangles, projecting vertices, the stages of rasterizeMesh() and
+// loading every mesh in the inputs directory. results are written as json so they can be tracked between commits.
+// usage: RendererBench [--inputs DIR] [--output FILE] [--filter TEXT] [--min-time SECONDS]
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "InputHandler.h"
+#include "MappedFile.h"
+#include "MeshParser.h"
+#include "ObjParser.h"
+#include "ThreadPool.h"
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+struct BenchOptions {
+    std::string inputs = "../inputs";
+    std::string outputFile;
+    std::string filter;
+    // each benchmark keeps taking samples for at least this long
+    double minTime = 0.2;
+};
+
+struct BenchResult {
+    std::string name;
+    // what one operation is ("triangle", "vertex", "frame", "file")
+    std::string unit;
+    // operations per sample
+    size_t operations = 0;
+    size_t samples = 0;
+    // nanoseconds per operation over the samples
+    double mean = 0, min = 0, median = 0, max = 0;
+    // optional extra throughput figure, like pixels per second
+    std::string rateName;
+    double rate = 0;
+};
+
+static std::vector<BenchResult> results;
+static BenchOptions options;
+
+static bool isSelected(const std::string &name) {
+    return options.filter.empty() || name.find(options.filter) != std::string::npos;
+}
+
+// calls run (which does `operations` operations) once to warm up, then as many times as fit in minTime, and records
+// the time per operation of every call
+template <typename Function>
+static BenchResult *measure(const std::string &name, const std::string &unit, size_t operations, Function run) {
+    if (!isSelected(name)) return nullptr;
+    run();
+    std::vector<double> times;
+    auto start = Clock::now();
+    do {
+        auto sampleStart = Clock::now();
+        run();
+        times.push_back(std::chrono::duration<double, std::nano>(Clock::now() - sampleStart).count() / operations);
+    } while (times.size() < 5 || std::chrono::duration<double>(Clock::now() - start).count() < options.minTime);
+
+    std::sort(times.begin(), times.end());
+    BenchResult result;
+    result.name = name;
+    result.unit = unit;
+    result.operations = operations;
+    result.samples = times.size();
+    for (double time : times) result.mean += time;
+    result.mean /= times.size();
+    result.min = times.front();
+    result.median = times[times.size() / 2];
+    result.max = times.back();
+    results.push_back(result);
+    std::cerr << name << ": " << result.median << " ns/" << unit << std::endl;
+    return &results.back();
+}
+
+// loadMeshFromFile() reports what it loaded on std::cout, which would end up in the json
+struct QuietCout {
+    std::ostringstream sink;
+    std::streambuf *old = std::cout.rdbuf(sink.rdbuf());
+    ~QuietCout() {
+        std::cout.rdbuf(old);
+    }
+};
+
+static void benchFillTriangle() {
+    const int width = 1100, height = 800;
+    Framebuffer framebuffer;
+    framebuffer.create(width, height);
+    RasterTarget target = framebuffer.getTarget();
+
+    // right triangles with legs of `size` pixels, spread over the screen so they don't all hit the same cache lines
+    struct Size {
+        const char *name;
+        double size;
+    };
+    for (Size size : {Size{"small", 4}, Size{"medium", 48}, Size{"large", 600}}) {
+        std::vector<Vec3D> corners;
+        for (int i = 0; i < 256; i++) {
+            double x = (i * 37) % static_cast<int>(width - size.size);
+            double y = (i * 53) % static_cast<int>(height - size.size);
+            corners.emplace_back(x + 0.3, y + 0.4, 1.0);
+            corners.emplace_back(x + size.size, y + 0.4, 1.0);
+            corners.emplace_back(x + 0.3, y + size.size, 1.0);
+        }
+        size_t triangles = corners.size() / 3;
+        BenchResult *result = measure(std::string("fillTriangle/") + size.name, "triangle", triangles, [&] {
+            for (size_t i = 0; i < corners.size(); i += 3) {
+                fillTriangle(corners[i], corners[i + 1], corners[i + 2], sf::Color(200, 200, 200), target);
+            }
+        });
+        if (result) {
+            result->rateName = "pixelsPerSecond";
+            result->rate = size.size * size.size / 2 / (result->median * 1e-9);
+        }
+    }
+}
+
+static void benchTransform(const Mesh &mesh) {
+    ViewState view(Vec3D(0, 0, -3), 0.1, 0.2, 1100, 800);
+    size_t count = mesh.getVertexCount();
+    VertexStreams screen;
+    screen.resize(count);
+    std::vector<Vec2D> projected(count);
+
+    measure("transform/getProjectedVector", "vertex", count, [&] {
+        for (uint32_t i = 0; i < count; i++) projected[i] = getProjectedVector(mesh.getVertex(i), view);
+    });
+    measure("transform/getProjectedPoint", "vertex", count, [&] {
+        for (uint32_t i = 0; i < count; i++) {
+            Vec3D p = getProjectedPoint(mesh.getVertex(i), view);
+            screen.x[i] = p.x;
+            screen.y[i] = p.y;
+            screen.z[i] = p.z;
+        }
+    });
+    measure(std::string("transform/projectPoints/") + getProjectionKernelName(), "vertex", count, [&] {
+        projectPoints(view, mesh.x.data(), mesh.y.data(), mesh.z.data(), count, screen.x.data(), screen.y.data(), screen.z.data());
+    });
+
+    // the float pipeline on the same points, stored as floats relative to the mesh's center like MeshFormat::Float
+    std::vector<float> x(count), y(count), z(count);
+    for (uint32_t i = 0; i < count; i++) {
+        Vec3F p(mesh.getVertex(i) - mesh.center);
+        x[i] = p.x;
+        y[i] = p.y;
+        z[i] = p.z;
+    }
+    Matrix4x4 translation(Vec4D(1, 0, 0, 0), Vec4D(0, 1, 0, 0), Vec4D(0, 0, 1, 0),
+                          Vec4D(mesh.center.x, mesh.center.y, mesh.center.z, 1));
+    Matrix4x4F toClip(view.viewProjection * translation);
+    measure(std::string("transform/projectPointsFloat/") + getProjectionKernelName(), "vertex", count, [&] {
+        projectPoints(view, toClip, x.data(), y.data(), z.data(), count, screen.x.data(), screen.y.data(), screen.z.data());
+    });
+}
+
+static void benchRasterizeMesh(const std::string &name, const Mesh &mesh) {
+    Framebuffer framebuffer;
+    framebuffer.create(1100, 800);
+    DepthBuffer depthBuffer;
+    depthBuffer.create(1100, 800);
+    RasterScratch scratch;
+    RenderOptions renderOptions;
+    renderOptions.depthMode = DepthMode::ZBufferFrontToBack;
+    ViewState view(Vec3D(0, 0, -3), 0, 0, 1100, 800);
+    Vec3D lightSource(150, 150, -200);
+
+    // the stages are timed inside rasterizeMesh(), so every sample gives all of them at once. they're reported as
+    // separate benchmarks with the same sample count. total also includes clearing the buffers
+    std::string prefix = "rasterizeMesh/" + name + "/";
+    std::vector<FrameStats> frames;
+    BenchResult *total = measure(prefix + "total", "frame", 1, [&] {
+        framebuffer.clear(sf::Color::Magenta);
+        depthBuffer.clear();
+        FrameStats frameStats;
+        rasterizeMesh(mesh, view, framebuffer, &depthBuffer, scratch, lightSource, renderOptions, &frameStats);
+        frames.push_back(frameStats);
+    });
+    if (!total) return;
+    // the warm up frame isn't part of the samples. copied because adding the stages can move the results
+    frames.erase(frames.begin());
+    BenchResult frameResult = *total;
+
+    auto addStage = [&](const char *stage, double FrameStats::*time) {
+        std::vector<double> times;
+        for (const auto &frame : frames) times.push_back(frame.*time * 1e6);
+        std::sort(times.begin(), times.end());
+        BenchResult result = frameResult;
+        result.name = prefix + stage;
+        result.mean = 0;
+        for (double t : times) result.mean += t;
+        result.mean /= times.size();
+        result.min = times.front();
+        result.median = times[times.size() / 2];
+        result.max = times.back();
+        results.push_back(result);
+    };
+    addStage("cull", &FrameStats::cullTime);
+    addStage("sort", &FrameStats::sortTime);
+    addStage("project", &FrameStats::projectTime);
+    addStage("draw", &FrameStats::drawTime);
+}
+
+static void benchLoad(const fs::path &file) {
+    std::string name = file.filename().string();
+    // parsing from scratch, without the .rmesh cache
+    measure("load/" + name + "/parse", "file", 1, [&] {
+        QuietCout quiet;
+        Mesh mesh;
+        if (hasExtension(file, ".obj")) {
+            MeshData data;
+            ObjInfo info;
+            parseObjFile(file.string(), data, info);
+            mesh = Mesh(std::move(data));
+        } else {
+            MappedFile mapped;
+            mapped.open(file.string());
+            MeshBuilder builder;
+            parseMeshText(mapped.data(), mapped.data() + mapped.size(), builder);
+            mesh = builder.build();
+        }
+    });
+    // what the program does on every run after the first
+    measure("load/" + name + "/cached", "file", 1, [&] {
+        QuietCout quiet;
+        loadMeshFromFile(file.string());
+    });
+}
+
+static std::string escapeJson(const std::string &text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+static void writeJson(std::ostream &out) {
+    out << "{\n  \"machine\": {\"coverageKernel\": \"" << getCoverageKernelName() << "\", \"projectionKernel\": \""
+        << getProjectionKernelName() << "\", \"threads\": " << getThreadPool().getThreadCount() << "},\n";
+    out << "  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult &r = results[i];
+        out << "    {\"name\": \"" << escapeJson(r.name) << "\", \"unit\": \"ns/" << r.unit << "\", \"operations\": "
+            << r.operations << ", \"samples\": " << r.samples << ", \"mean\": " << r.mean << ", \"min\": " << r.min
+            << ", \"median\": " << r.median << ", \"max\": " << r.max;
+        if (!r.rateName.empty()) out << ", \"" << r.rateName << "\": " << r.rate;
+        out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+static bool parseArguments(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "missing value for " << arg << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--inputs") options.inputs = value;
+        else if (arg == "--output") options.outputFile = value;
+        else if (arg == "--filter") options.filter = value;
+        else if (arg == "--min-time") {
+            auto [last, error] = std::from_chars(value.data(), value.data() + value.size(), options.minTime);
+            if (error != std::errc() || last != value.data() + value.size()) {
+                std::cerr << "invalid value for --min-time: " << value << std::endl;
+                return false;
+            }
+        } else {
+            std::cerr << "unknown option " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    if (!parseArguments(argc, argv)) return 1;
+    std::cout.precision(10);
+
+    // the meshes, sorted so the benchmarks always come out in the same order
+    std::vector<fs::path> files;
+    std::error_code error;
+    for (const auto &entry : fs::directory_iterator(options.inputs, error)) {
+        if (entry.is_regular_file() && (hasExtension(entry.path(), ".txt") || hasExtension(entry.path(), ".obj"))) {
+            files.push_back(entry.path());
+        }
+    }
+    if (error) {
+        std::cerr << "can't read inputs directory '" << options.inputs << "'" << std::endl;
+        return 1;
+    }
+    std::sort(files.begin(), files.end());
+
+    benchFillTriangle();
+
+    std::vector<std::pair<std::string, Mesh>> meshes;
+    {
+        QuietCout quiet;
+        for (const auto &file : files) meshes.emplace_back(file.stem().string(), loadMeshFromFile(file.string()));
+    }
+    // the transform benchmarks use the mesh with the most vertices
+    auto largest = std::max_element(meshes.begin(), meshes.end(), [](const auto &a, const auto &b) {
+        return a.second.getVertexCount() < b.second.getVertexCount();
+    });
+    if (largest != meshes.end()) benchTransform(largest->second);
+    for (const auto &[name, mesh] : meshes) benchRasterizeMesh(name, mesh);
+    for (const auto &file : files) benchLoad(file);
+
+    if (options.outputFile.empty()) {
+        writeJson(std::cout);
+        return 0;
+    }
+    std::ofstream out(options.outputFile);
+    out.precision(10);
+    writeJson(out);
+    if (!out) {
+        std::cerr << "can't write '" << options.outputFile << "'" << std::endl;
+        return 1;
+    }
+    return 0;
+}
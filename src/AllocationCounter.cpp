@@ -0,0 +1,123 @@
+//
+// Created by Cooper Stevens on 3/20/25.
+//
+
+#include "AllocationCounter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef NDEBUG
+
+uint64_t getAllocationCount() {
+    return 0;
+}
+
+#else
+
+// relaxed is enough, the count is only read between frames
+static std::atomic<uint64_t> allocationCount{0};
+
+uint64_t getAllocationCount() {
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+static void *countedAllocate(size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    // malloc(0) may return null, but new has to return a unique pointer
+    return std::malloc(size ? size : 1);
+}
+
+static void *countedAllocateAligned(size_t size, std::align_val_t alignment) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    size_t align = static_cast<size_t>(alignment);
+    // aligned_alloc wants the size to be a nonzero multiple of the alignment
+    return std::aligned_alloc(align, std::max(align, (size + align - 1) / align * align));
+}
+
+void *operator new(size_t size) {
+    if (void *block = countedAllocate(size)) return block;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size) {
+    return ::operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+    return countedAllocate(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+    return countedAllocate(size);
+}
+
+void *operator new(size_t size, std::align_val_t alignment) {
+    if (void *block = countedAllocateAligned(size, alignment)) return block;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size, std::align_val_t alignment) {
+    return ::operator new(size, alignment);
+}
+
+void *operator new(size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+    return countedAllocateAligned(size, alignment);
+}
+
+void *operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+    return countedAllocateAligned(size, alignment);
+}
+
+// both kinds of block come from the C allocator, so they're all freed the same way
+void operator delete(void *block) noexcept {
+    std::free(block);
+}
+
+void operator delete[](void *block) noexcept {
+    std::free(block);
+}
+
+void operator delete(void *block, size_t) noexcept {
+    std::free(block);
+}
+
+void operator delete[](void *block, size_t) noexcept {
+    std::free(block);
+}
+
+void operator delete(void *block, std::align_val_t) noexcept {
+    std::free(block);
+}
+
+void operator delete[](void *block, std::align_val_t) noexcept {
+    std::free(block);
+}
+
+void operator delete(void *block, size_t, std::align_val_t) noexcept {
+    std::free(block);
+}
+
+void operator delete[](void *block, size_t, std::align_val_t) noexcept {
+    std::free(block);
+}
+
+void operator delete(void *block, const std::nothrow_t &) noexcept {
+    std::free(block);
+}
+
+void operator delete[](void *block, const std::nothrow_t &) noexcept {
+    std::free(block);
+}
+
+void operator delete(void *block, std::align_val_t, const std::nothrow_t &) noexcept {
+    std::free(block);
+}
+
+void operator delete[](void *block, std::align_val_t, const std::nothrow_t &) noexcept {
+    std::free(block);
+}
+
+#endif
@@ -0,0 +1,21 @@
+//
+// Created by Cooper Stevens on 3/20/25.
+//
+
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <cstdint>
+
+// debug builds (without NDEBUG) replace the global operator new to count every heap allocation in the program, so the
+// replay benchmark can check that drawing a frame doesn't allocate. release builds keep the standard allocator
+#ifdef NDEBUG
+constexpr bool ALLOCATION_COUNTING = false;
+#else
+constexpr bool ALLOCATION_COUNTING = true;
+#endif
+
+// heap allocations made so far by all threads. always 0 without ALLOCATION_COUNTING
+uint64_t getAllocationCount();
+
+#endif
@@ -0,0 +1,93 @@
+//
+// Created by Cooper Stevens on 3/14/25.
+//
+
+#include "CameraPath.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <fstream>
+#include <iostream>
+
+static Vec3D lerp(const Vec3D &a, const Vec3D &b, double t) {
+    return a + (b - a) * t;
+}
+
+CameraKeyframe CameraPath::sample(double time) const {
+    if (keyframes.empty()) return CameraKeyframe();
+    time += keyframes.front().time;
+    if (time <= keyframes.front().time) return keyframes.front();
+    if (time >= keyframes.back().time) return keyframes.back();
+
+    // first keyframe after time
+    auto next = std::upper_bound(keyframes.begin(), keyframes.end(), time, [](double t, const CameraKeyframe &key) {
+        return t < key.time;
+    });
+    const CameraKeyframe &a = *(next - 1);
+    const CameraKeyframe &b = *next;
+    double t = (time - a.time) / (b.time - a.time);
+
+    CameraKeyframe pose;
+    pose.time = time;
+    pose.cameraPos = lerp(a.cameraPos, b.cameraPos, t);
+    pose.camAngleX = a.camAngleX + (b.camAngleX - a.camAngleX) * t;
+    pose.camAngleY = a.camAngleY + (b.camAngleY - a.camAngleY) * t;
+    pose.hasLight = a.hasLight && b.hasLight;
+    if (pose.hasLight) pose.lightSource = lerp(a.lightSource, b.lightSource, t);
+    return pose;
+}
+
+bool loadCameraPath(const std::string &filename, CameraPath &path) {
+    std::ifstream infile(filename);
+    if (!infile.is_open()) {
+        std::cerr << "can't open camera path '" << filename << "'." << std::endl;
+        return false;
+    }
+
+    path.keyframes.clear();
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(infile, line)) {
+        ++lineNumber;
+        const char *p = line.data();
+        const char *end = p + line.size();
+        while (p < end && std::isspace(static_cast<unsigned char>(*p))) p++;
+        if (p == end || *p == '#') continue;
+
+        // time, position, yaw and pitch, then the light if it's there
+        double values[9];
+        int count = 0;
+        while (count < 9) {
+            while (p < end && std::isspace(static_cast<unsigned char>(*p))) p++;
+            if (p == end) break;
+            auto [next, error] = std::from_chars(p, end, values[count]);
+            if (error != std::errc()) break;
+            p = next;
+            count++;
+        }
+        while (p < end && std::isspace(static_cast<unsigned char>(*p))) p++;
+        if ((count != 6 && count != 9) || p != end) {
+            std::cerr << "invalid camera keyframe at line " << lineNumber << ": " << line << std::endl;
+            return false;
+        }
+
+        CameraKeyframe key;
+        key.time = values[0];
+        key.cameraPos = Vec3D(values[1], values[2], values[3]);
+        key.camAngleY = values[4] * M_PI / 180.0;
+        key.camAngleX = std::clamp(values[5] * M_PI / 180.0, -M_PI / 2.0 + 0.01, M_PI / 2.0 - 0.01);
+        key.hasLight = count == 9;
+        if (key.hasLight) key.lightSource = Vec3D(values[6], values[7], values[8]);
+        path.keyframes.push_back(key);
+    }
+
+    if (path.keyframes.empty()) {
+        std::cerr << "no keyframes in camera path '" << filename << "'." << std::endl;
+        return false;
+    }
+    std::stable_sort(path.keyframes.begin(), path.keyframes.end(), [](const CameraKeyframe &a, const CameraKeyframe &b) {
+        return a.time < b.time;
+    });
+    return true;
+}
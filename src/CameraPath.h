@@ -0,0 +1,42 @@
+//
+// Created by Cooper Stevens on 3/14/25.
+//
+
+#ifndef CAMERAPATH_H
+#define CAMERAPATH_H
+
+#include <string>
+#include <vector>
+#include "LinAlg.h"
+
+// camera (and optionally light) pose at a point in time
+struct CameraKeyframe {
+    double time = 0;
+    Vec3D cameraPos;
+    // radians, like ViewState
+    double camAngleX = 0;
+    double camAngleY = 0;
+    bool hasLight = false;
+    Vec3D lightSource;
+};
+
+// a camera flight through the scene. keyframes are sorted by time and poses between them are interpolated linearly,
+// so the same path and timestep always give the same frames
+struct CameraPath {
+    std::vector<CameraKeyframe> keyframes;
+
+    double getDuration() const {
+        return keyframes.empty() ? 0 : keyframes.back().time - keyframes.front().time;
+    }
+    // the pose at time (seconds from the first keyframe). times outside the path are clamped to its ends. the light
+    // is only interpolated when both keyframes around time have one
+    CameraKeyframe sample(double time) const;
+};
+
+// reads a camera path file: one keyframe per line, "time x y z yaw pitch" with optional "lightX lightY lightZ" after
+// it. times are in seconds and the angles in degrees. blank lines and lines starting with # are skipped.
+// keyframes don't have to be in order. prints what's wrong and returns false if the file can't be read, has an invalid
+// line or has no keyframes, since a benchmark with a silently different path wouldn't be comparable
+bool loadCameraPath(const std::string &filename, CameraPath &path);
+
+#endif
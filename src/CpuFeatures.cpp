@@ -0,0 +1,22 @@
+//
+// Created by Cooper Stevens on 2/3/25.
+//
+
+#include "CpuFeatures.h"
+
+static CpuFeatures detectCpuFeatures() {
+    CpuFeatures features;
+#if defined(__x86_64__) || defined(__i386__)
+    // these also check that the os saves the wider registers, not just that the cpu has them
+    __builtin_cpu_init();
+    features.sse2 = __builtin_cpu_supports("sse2");
+    features.avx2 = __builtin_cpu_supports("avx2");
+    features.avx512 = __builtin_cpu_supports("avx512f");
+#endif
+    return features;
+}
+
+const CpuFeatures &getCpuFeatures() {
+    static const CpuFeatures features = detectCpuFeatures();
+    return features;
+}
@@ -0,0 +1,17 @@
+//
+// Created by Cooper Stevens on 2/3/25.
+//
+
+#ifndef CPUFEATURES_H
+#define CPUFEATURES_H
+
+// instruction set extensions the simd kernels can use. detected once from cpuid the first time this is called
+struct CpuFeatures {
+    bool sse2 = false;
+    bool avx2 = false;
+    bool avx512 = false;
+};
+
+const CpuFeatures &getCpuFeatures();
+
+#endif
@@ -0,0 +1,109 @@
+//
+// Created by Cooper Stevens on 3/16/25.
+//
+
+#include "DebugText.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+// characters in the font, and their rows from top to bottom with the leftmost pixel in bit 4
+static const char FONT_CHARS[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ.:/-%()=,";
+static const uint8_t FONT_GLYPHS[][7] = {
+    {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E}, // 0
+    {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E}, // 1
+    {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F}, // 2
+    {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E}, // 3
+    {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02}, // 4
+    {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E}, // 5
+    {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E}, // 6
+    {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}, // 7
+    {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E}, // 8
+    {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C}, // 9
+    {0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11}, // A
+    {0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E}, // B
+    {0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E}, // C
+    {0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C}, // D
+    {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F}, // E
+    {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10}, // F
+    {0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F}, // G
+    {0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}, // H
+    {0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E}, // I
+    {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C}, // J
+    {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}, // K
+    {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F}, // L
+    {0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11}, // M
+    {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}, // N
+    {0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}, // O
+    {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10}, // P
+    {0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D}, // Q
+    {0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11}, // R
+    {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E}, // S
+    {0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}, // T
+    {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}, // U
+    {0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04}, // V
+    {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A}, // W
+    {0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11}, // X
+    {0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04}, // Y
+    {0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F}, // Z
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C}, // .
+    {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00}, // :
+    {0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00}, // /
+    {0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00}, // -
+    {0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03}, // %
+    {0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02}, // (
+    {0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08}, // )
+    {0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00}, // =
+    {0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08}, // ,
+};
+
+static const uint8_t *findGlyph(char c) {
+    if (c >= 'a' && c <= 'z') c = static_cast<char>(c - 'a' + 'A');
+    const char *found = c == '\0' ? nullptr : std::strchr(FONT_CHARS, c);
+    return found ? FONT_GLYPHS[found - FONT_CHARS] : nullptr;
+}
+
+// fills a rectangle clipped to the framebuffer
+static void fillRect(Framebuffer &framebuffer, int x, int y, int width, int height, uint32_t color) {
+    int minX = std::max(x, 0), maxX = std::min(x + width, framebuffer.getWidth());
+    int minY = std::max(y, 0), maxY = std::min(y + height, framebuffer.getHeight());
+    for (int j = minY; j < maxY; j++) {
+        uint32_t *row = framebuffer.getPixels() + static_cast<size_t>(j) * framebuffer.getPitch();
+        std::fill(row + minX, row + std::max(minX, maxX), color);
+    }
+}
+
+void drawDebugText(Framebuffer &framebuffer, int x, int y, std::string_view text, const sf::Color &color, int scale) {
+    uint32_t packed = packColor(color);
+    int penX = x;
+    for (char c : text) {
+        if (c == '\n') {
+            penX = x;
+            y += DEBUG_CHAR_HEIGHT * scale;
+            continue;
+        }
+        if (const uint8_t *glyph = findGlyph(c)) {
+            for (int row = 0; row < 7; row++) {
+                for (int column = 0; column < 5; column++) {
+                    if (glyph[row] & (0x10 >> column)) fillRect(framebuffer, penX + column * scale, y + row * scale, scale, scale, packed);
+                }
+            }
+        }
+        penX += DEBUG_CHAR_WIDTH * scale;
+    }
+}
+
+void darkenRect(Framebuffer &framebuffer, int x, int y, int width, int height) {
+    int minX = std::max(x, 0), maxX = std::min(x + width, framebuffer.getWidth());
+    int minY = std::max(y, 0), maxY = std::min(y + height, framebuffer.getHeight());
+    for (int j = minY; j < maxY; j++) {
+        sf::Uint8 *row = reinterpret_cast<sf::Uint8 *>(framebuffer.getPixels() + static_cast<size_t>(j) * framebuffer.getPitch());
+        // a quarter of the brightness, alpha left alone
+        for (int i = minX; i < maxX; i++) {
+            row[4 * i] >>= 2;
+            row[4 * i + 1] >>= 2;
+            row[4 * i + 2] >>= 2;
+        }
+    }
+}
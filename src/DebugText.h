@@ -0,0 +1,23 @@
+//
+// Created by Cooper Stevens on 3/16/25.
+//
+
+#ifndef DEBUGTEXT_H
+#define DEBUGTEXT_H
+
+#include <string_view>
+#include "Framebuffer.h"
+
+// size of a character cell in pixels at scale 1, including the gap to the next character and line
+constexpr int DEBUG_CHAR_WIDTH = 6;
+constexpr int DEBUG_CHAR_HEIGHT = 8;
+
+// draws text with a built in 5x7 pixel font, so overlays don't need a font file. only digits, letters (shown as
+// capitals), spaces and . : / - % ( ) = , are drawn; anything else is left blank. newlines start a new line.
+// each font pixel is drawn as a scale x scale block, and anything off the edge of the framebuffer is clipped
+void drawDebugText(Framebuffer &framebuffer, int x, int y, std::string_view text, const sf::Color &color, int scale = 1);
+
+// darkens the pixels of a rectangle (clipped to the framebuffer) so text on top of it stays readable
+void darkenRect(Framebuffer &framebuffer, int x, int y, int width, int height);
+
+#endif
@@ -0,0 +1,103 @@
+//
+// Created by Cooper Stevens on 2/16/25.
+//
+
+#include "DepthPyramid.h"
+
+#include <algorithm>
+
+void DepthPyramid::create(int w, int h) {
+    width = w;
+    height = h;
+    levels.clear();
+    int cellsX = (w + CELL_SIZE - 1) / CELL_SIZE;
+    int cellsY = (h + CELL_SIZE - 1) / CELL_SIZE;
+    while (true) {
+        Level level;
+        level.width = cellsX;
+        level.height = cellsY;
+        level.farthest.assign(static_cast<size_t>(cellsX) * cellsY, 0.0f);
+        level.dirty.assign(static_cast<size_t>(cellsX) * cellsY, 0);
+        levels.push_back(std::move(level));
+        if (cellsX == 1 && cellsY == 1) break;
+        cellsX = (cellsX + 1) / 2;
+        cellsY = (cellsY + 1) / 2;
+    }
+}
+
+void DepthPyramid::clear() {
+    for (auto &level : levels) {
+        std::fill(level.farthest.begin(), level.farthest.end(), 0.0f);
+        std::fill(level.dirty.begin(), level.dirty.end(), 0);
+    }
+}
+
+float DepthPyramid::getFarthest(int level, int x, int y, const float *depth, int pitch) {
+    Level &l = levels[level];
+    size_t cell = static_cast<size_t>(y) * l.width + x;
+    if (!l.dirty[cell]) return l.farthest[cell];
+
+    float farthest;
+    if (level == 0) {
+        int minX = x * CELL_SIZE, maxX = std::min(width, minX + CELL_SIZE);
+        int minY = y * CELL_SIZE, maxY = std::min(height, minY + CELL_SIZE);
+        farthest = depth[static_cast<size_t>(minY) * pitch + minX];
+        for (int j = minY; j < maxY; j++) {
+            const float *row = depth + static_cast<size_t>(j) * pitch;
+            for (int i = minX; i < maxX; i++) farthest = std::min(farthest, row[i]);
+        }
+    } else {
+        // the farthest of the (up to) four cells below
+        const Level &below = levels[level - 1];
+        farthest = getFarthest(level - 1, 2 * x, 2 * y, depth, pitch);
+        if (2 * x + 1 < below.width) farthest = std::min(farthest, getFarthest(level - 1, 2 * x + 1, 2 * y, depth, pitch));
+        if (2 * y + 1 < below.height) {
+            farthest = std::min(farthest, getFarthest(level - 1, 2 * x, 2 * y + 1, depth, pitch));
+            if (2 * x + 1 < below.width) farthest = std::min(farthest, getFarthest(level - 1, 2 * x + 1, 2 * y + 1, depth, pitch));
+        }
+    }
+    l.farthest[cell] = farthest;
+    l.dirty[cell] = 0;
+    return farthest;
+}
+
+bool DepthPyramid::isOccluded(const PixelRect &rect, float nearestDepth, const float *depth, int pitch, int maxLevel) {
+    // interpolating across the triangle can round slightly past its vertices, so leave a little room
+    float nearest = nearestDepth * 1.0001f;
+
+    // use the finest level where the rect spans at most 2x2 cells. a coarser cell covers more than the rect,
+    // so its farthest depth can only be farther than the rect's and the test stays conservative
+    int level = 0;
+    int topLevel = std::min(maxLevel, getLevelCount() - 1);
+    while (level < topLevel) {
+        int shift = CELL_SIZE_BITS + level;
+        if ((rect.maxX >> shift) - (rect.minX >> shift) <= 1 && (rect.maxY >> shift) - (rect.minY >> shift) <= 1) break;
+        level++;
+    }
+
+    int shift = CELL_SIZE_BITS + level;
+    for (int y = rect.minY >> shift; y <= rect.maxY >> shift; y++) {
+        for (int x = rect.minX >> shift; x <= rect.maxX >> shift; x++) {
+            if (!(nearest < getFarthest(level, x, y, depth, pitch))) return false;
+        }
+    }
+    return true;
+}
+
+void DepthPyramid::markDrawn(const PixelRect &rect, int maxLevel) {
+    for (int level = 0; level <= std::min(maxLevel, getLevelCount() - 1); level++) {
+        Level &l = levels[level];
+        int shift = CELL_SIZE_BITS + level;
+        for (int y = rect.minY >> shift; y <= rect.maxY >> shift; y++) {
+            for (int x = rect.minX >> shift; x <= rect.maxX >> shift; x++) {
+                l.dirty[static_cast<size_t>(y) * l.width + x] = 1;
+            }
+        }
+    }
+}
+
+void DepthPyramid::markLevelsAboveDrawn(int level) {
+    for (int i = level + 1; i < getLevelCount(); i++) {
+        std::fill(levels[i].dirty.begin(), levels[i].dirty.end(), 1);
+    }
+}
@@ -0,0 +1,54 @@
+//
+// Created by Cooper Stevens on 2/16/25.
+//
+
+#ifndef DEPTHPYRAMID_H
+#define DEPTHPYRAMID_H
+
+#include <cstdint>
+#include <vector>
+#include "RasterKernels.h"
+
+// a coarse version of the depth buffer used to throw away hidden triangles before they're rasterized (hierarchical z).
+// level 0 has one cell per 8x8 pixels and every level above halves the resolution. each cell holds the farthest depth
+// (smallest 1/depth) drawn anywhere in it, so anything farther than that can't show up in the cell.
+// cells are only marked when something is drawn under them and recomputed the next time a test needs them
+class DepthPyramid {
+public:
+    static constexpr int CELL_SIZE_BITS = 3;
+    static constexpr int CELL_SIZE = 1 << CELL_SIZE_BITS;
+
+    void create(int width, int height);
+    // resets every cell to "nothing drawn"
+    void clear();
+
+    int getLevelCount() const {
+        return static_cast<int>(levels.size());
+    }
+
+    // true if every pixel of rect already holds something closer than nearestDepth (the largest 1/depth the triangle
+    // reaches), so the triangle would fail the depth test everywhere in it. depth is the full resolution buffer with
+    // the given pitch. only cells up to maxLevel are used, which lets threads that each own a tile share the pyramid
+    bool isOccluded(const PixelRect &rect, float nearestDepth, const float *depth, int pitch, int maxLevel);
+
+    // call after drawing into rect so the cells under it (up to maxLevel) get recomputed
+    void markDrawn(const PixelRect &rect, int maxLevel);
+    // marks every cell above level as changed. used after the tiles have been drawn with markDrawn() limited to
+    // the levels inside a tile
+    void markLevelsAboveDrawn(int level);
+
+private:
+    struct Level {
+        int width, height;
+        // farthest depth in each cell
+        std::vector<float> farthest;
+        std::vector<uint8_t> dirty;
+    };
+
+    float getFarthest(int level, int x, int y, const float *depth, int pitch);
+
+    std::vector<Level> levels;
+    int width = 0, height = 0;
+};
+
+#endif
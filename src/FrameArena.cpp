@@ -0,0 +1,48 @@
+//
+// Created by Cooper Stevens on 3/20/25.
+//
+
+#include "FrameArena.h"
+
+#include <new>
+
+static void *allocateAligned(size_t bytes) {
+    return ::operator new(bytes, std::align_val_t(FrameArena::ALIGNMENT));
+}
+
+static void freeAligned(void *block) {
+    ::operator delete(block, std::align_val_t(FrameArena::ALIGNMENT));
+}
+
+FrameArena::~FrameArena() {
+    reset();
+    if (buffer) freeAligned(buffer);
+}
+
+void *FrameArena::allocateBytes(size_t bytes) {
+    bytes = (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    if (used + bytes <= capacity) {
+        void *block = buffer + used;
+        used += bytes;
+        return block;
+    }
+    // earlier arrays may still be in use, so the buffer can't move now
+    void *block = allocateAligned(bytes);
+    overflow.push_back(block);
+    overflowBytes += bytes;
+    return block;
+}
+
+void FrameArena::reset() {
+    if (!overflow.empty()) {
+        for (void *block : overflow) freeAligned(block);
+        // a quarter extra, so a draw that's a little bigger every time doesn't grow the buffer every time
+        size_t needed = used + overflowBytes;
+        capacity = (needed + needed / 4 + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+        if (buffer) freeAligned(buffer);
+        buffer = static_cast<std::byte *>(allocateAligned(capacity));
+        overflow.clear();
+        overflowBytes = 0;
+    }
+    used = 0;
+}
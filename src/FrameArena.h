@@ -0,0 +1,52 @@
+//
+// Created by Cooper Stevens on 3/20/25.
+//
+
+#ifndef FRAMEARENA_H
+#define FRAMEARENA_H
+
+#include <cstddef>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+// a linear allocator for arrays that only live for one draw. allocating moves a pointer along one buffer and reset()
+// gives everything back at once, so nothing is freed one array at a time. when a draw needs more than the buffer
+// holds the extra arrays get blocks of their own, and the next reset() replaces the buffer with one big enough for
+// all of it, so once the buffer has grown to the biggest draw, drawing doesn't touch the heap at all
+class FrameArena {
+public:
+    // every array starts on its own cache line, so threads filling neighbouring arrays don't share lines
+    static constexpr size_t ALIGNMENT = 64;
+
+    FrameArena() = default;
+    ~FrameArena();
+    FrameArena(const FrameArena &) = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+
+    // room for count items, valid until the next reset(). nothing is constructed or zeroed, so only for plain types
+    template <typename T>
+    std::span<T> allocate(size_t count) {
+        static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>);
+        static_assert(alignof(T) <= ALIGNMENT);
+        return {static_cast<T *>(allocateBytes(count * sizeof(T))), count};
+    }
+    // gives back everything allocated since the last reset
+    void reset();
+
+    size_t getCapacity() const {
+        return capacity;
+    }
+
+private:
+    void *allocateBytes(size_t bytes);
+
+    std::byte *buffer = nullptr;
+    size_t capacity = 0;
+    size_t used = 0;
+    // blocks for what didn't fit this time, and how big they are together
+    std::vector<void *> overflow;
+    size_t overflowBytes = 0;
+};
+
+#endif
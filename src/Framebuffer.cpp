@@ -0,0 +1,45 @@
+//
+// Created by Cooper Stevens on 3/13/25.
+//
+
+#include "Framebuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+void Framebuffer::create(int w, int h) {
+    width = w;
+    height = h;
+    pitch = w;
+    size_t count = static_cast<size_t>(pitch) * height;
+    pixels.reset(static_cast<uint32_t *>(::operator new[](std::max<size_t>(1, count) * sizeof(uint32_t), std::align_val_t(ALIGNMENT))));
+    clear(sf::Color::Black);
+}
+
+void Framebuffer::clear(const sf::Color &color) {
+    size_t count = static_cast<size_t>(pitch) * height;
+    // gray levels (all four bytes the same) can go through memset, everything else is a plain fill the compiler turns
+    // into wide stores. either way it's a straight run over one block instead of a call per pixel
+    if (color.r == color.g && color.g == color.b && color.b == color.a) {
+        std::memset(pixels.get(), color.r, count * sizeof(uint32_t));
+    } else {
+        std::fill_n(pixels.get(), count, packColor(color));
+    }
+}
+
+sf::Color Framebuffer::getPixel(int x, int y) const {
+    const sf::Uint8 *p = getBytes() + 4 * (static_cast<size_t>(y) * pitch + x);
+    return sf::Color(p[0], p[1], p[2], p[3]);
+}
+
+RasterTarget Framebuffer::getTarget() {
+    return {pixels.get(), width, height, pitch};
+}
+
+void Framebuffer::present(sf::Texture &texture) const {
+    texture.update(getBytes());
+}
+
+void Framebuffer::copyToImage(sf::Image &image) const {
+    image.create(static_cast<unsigned int>(width), static_cast<unsigned int>(height), getBytes());
+}
@@ -0,0 +1,72 @@
+//
+// Created by Cooper Stevens on 3/13/25.
+//
+
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <SFML/Graphics.hpp>
+#include "RasterKernels.h"
+
+// the pixels the renderer draws into: RGBA8 in the byte order sf::Texture expects (see packColor()), starting on a
+// cache line boundary. rows are pitch pixels apart. pitch is the width, so the whole frame is one contiguous block
+// that can be handed to the texture in a single update
+class Framebuffer {
+public:
+    Framebuffer() = default;
+    Framebuffer(const Framebuffer &) = delete;
+    Framebuffer &operator=(const Framebuffer &) = delete;
+    Framebuffer(Framebuffer &&) noexcept = default;
+    Framebuffer &operator=(Framebuffer &&) noexcept = default;
+
+    void create(int width, int height);
+    // fills every pixel with color
+    void clear(const sf::Color &color);
+
+    int getWidth() const {
+        return width;
+    }
+    int getHeight() const {
+        return height;
+    }
+    // distance between rows, in pixels
+    int getPitch() const {
+        return pitch;
+    }
+    uint32_t *getPixels() {
+        return pixels.get();
+    }
+    const uint32_t *getPixels() const {
+        return pixels.get();
+    }
+    // the pixels as bytes, R G B A for every pixel
+    const sf::Uint8 *getBytes() const {
+        return reinterpret_cast<const sf::Uint8 *>(pixels.get());
+    }
+    sf::Color getPixel(int x, int y) const;
+
+    // target for the raster kernels, without a depth buffer
+    RasterTarget getTarget();
+
+    // uploads the frame to a texture of the same size
+    void present(sf::Texture &texture) const;
+    // copies the frame into an image, e.g. for saving it
+    void copyToImage(sf::Image &image) const;
+
+private:
+    static constexpr size_t ALIGNMENT = 64;
+    struct AlignedDelete {
+        void operator()(uint32_t *p) const {
+            ::operator delete[](p, std::align_val_t(ALIGNMENT));
+        }
+    };
+
+    std::unique_ptr<uint32_t[], AlignedDelete> pixels;
+    int width = 0, height = 0, pitch = 0;
+};
+
+#endif
@@ -0,0 +1,285 @@
+//
+// Created by Cooper Stevens on 3/12/25.
+//
+
+#include "HeadlessRenderer.h"
+
+#include <charconv>
+#include <chrono>
+#include <iostream>
+#include <string_view>
+#include "AllocationCounter.h"
+#include "CameraPath.h"
+#include "ImageWriter.h"
+#include "InputHandler.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include "Tracer.h"
+
+// reads count comma separated numbers, like "0,0,-3"
+static bool parseNumbers(std::string_view text, double *values, int count) {
+    const char *p = text.data();
+    const char *end = p + text.size();
+    for (int i = 0; i < count; i++) {
+        if (i > 0) {
+            if (p == end || *p != ',') return false;
+            p++;
+        }
+        auto [next, error] = std::from_chars(p, end, values[i]);
+        if (error != std::errc()) return false;
+        p = next;
+    }
+    return p == end;
+}
+
+static bool parseVector(std::string_view text, Vec3D &v) {
+    double values[3];
+    if (!parseNumbers(text, values, 3)) return false;
+    v = Vec3D(values[0], values[1], values[2]);
+    return true;
+}
+
+// "1100x800"
+static bool parseResolution(std::string_view text, int &width, int &height) {
+    const char *p = text.data();
+    const char *end = p + text.size();
+    auto [x, widthError] = std::from_chars(p, end, width);
+    if (widthError != std::errc() || x == end || (*x != 'x' && *x != 'X')) return false;
+    auto [last, heightError] = std::from_chars(x + 1, end, height);
+    return heightError == std::errc() && last == end && width > 0 && height > 0;
+}
+
+void printHeadlessUsage(const char *program) {
+    std::cout << "usage: " << program << " --mesh FILE [--mesh FILE...] --output FILE [options]\n"
+                 "renders one frame without opening a window and writes it to a .ppm or .png file\n\n"
+                 "  --mesh FILE        .txt or .obj mesh to render (can be given more than once)\n"
+                 "  --output FILE      where to write the frame, .ppm or .png\n"
+                 "  --camera X,Y,Z     camera position (default 0,0,-3)\n"
+                 "  --yaw DEGREES      turn the camera right (default 0)\n"
+                 "  --pitch DEGREES    turn the camera up, between -89 and 89 (default 0)\n"
+                 "  --light X,Y,Z      point light position (default 150,150,-200)\n"
+                 "  --light camera     put the light at the camera\n"
+                 "  --size WxH         resolution in pixels (default 1100x800)\n"
+                 "  --mesh-format F    store the meshes as double (default), float or quantized16: float positions\n"
+                 "                     or 16 bit ones within the bounds, and 4 byte normals\n"
+                 "  --trace FILE       write a timeline of the run for perfetto or about://tracing\n\n"
+                 "benchmark: replay a camera path instead of rendering one frame, and print frame times\n"
+                 "  --path FILE        camera path, one \"time x y z yaw pitch [lightX lightY lightZ]\" keyframe per line\n"
+                 "  --frames N         number of frames to render (default: until the end of the path)\n"
+                 "  --timestep SECONDS path time between frames (default 1/60)\n"
+                 "  --output FILE      optional here, gets the last frame\n"
+                 "  --profile FILE     write per-stage timings and histograms as json\n"
+                 "  --help             show this message\n";
+}
+
+bool parseHeadlessOptions(int argc, char *argv[], HeadlessOptions &options) {
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            options.showHelp = true;
+            return true;
+        }
+        // every other option takes a value
+        if (i + 1 >= argc) {
+            std::cerr << "missing value for " << arg << std::endl;
+            return false;
+        }
+        std::string_view value = argv[++i];
+        bool valid = true;
+        if (arg == "--mesh") {
+            options.meshFiles.emplace_back(value);
+        } else if (arg == "--output") {
+            options.outputFile = value;
+        } else if (arg == "--camera") {
+            valid = parseVector(value, options.cameraPos);
+        } else if (arg == "--yaw" || arg == "--pitch") {
+            double degrees;
+            valid = parseNumbers(value, &degrees, 1);
+            if (arg == "--yaw") options.camAngleY = degrees * M_PI / 180.0;
+            // the same limit the arrow keys have, so the camera can't flip over
+            else options.camAngleX = std::clamp(degrees * M_PI / 180.0, -M_PI / 2.0 + 0.01, M_PI / 2.0 - 0.01);
+        } else if (arg == "--light") {
+            options.lightFollowCamera = value == "camera";
+            valid = options.lightFollowCamera || parseVector(value, options.lightSource);
+        } else if (arg == "--size") {
+            valid = parseResolution(value, options.width, options.height);
+        } else if (arg == "--mesh-format") {
+            valid = false;
+            for (MeshFormat format : {MeshFormat::Double, MeshFormat::Float, MeshFormat::Quantized16}) {
+                if (value == getMeshFormatName(format)) {
+                    options.meshFormat = format;
+                    valid = true;
+                }
+            }
+        } else if (arg == "--path") {
+            options.cameraPathFile = value;
+        } else if (arg == "--frames") {
+            auto [last, error] = std::from_chars(value.data(), value.data() + value.size(), options.frameCount);
+            valid = error == std::errc() && last == value.data() + value.size() && options.frameCount > 0;
+        } else if (arg == "--trace") {
+            options.traceFile = value;
+        } else if (arg == "--profile") {
+            options.profileFile = value;
+        } else if (arg == "--timestep") {
+            valid = parseNumbers(value, &options.timestep, 1) && options.timestep > 0;
+        } else {
+            std::cerr << "unknown option " << arg << " (see --help)" << std::endl;
+            return false;
+        }
+        if (!valid) {
+            std::cerr << "invalid value for " << arg << ": " << value << std::endl;
+            return false;
+        }
+    }
+
+    if (options.meshFiles.empty() || (options.outputFile.empty() && options.cameraPathFile.empty())) {
+        std::cerr << "--mesh and --output (or --path) are required (see --help)" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// the buffers a headless frame is drawn into, set up like the window's
+struct HeadlessTarget {
+    Framebuffer framebuffer;
+    DepthBuffer depthBuffer;
+    RasterScratch scratch;
+    RenderOptions renderOptions;
+
+    HeadlessTarget(int width, int height) {
+        framebuffer.create(width, height);
+        depthBuffer.create(width, height);
+        renderOptions.depthMode = DepthMode::ZBufferFrontToBack;
+    }
+
+    // clears and draws one frame, the same way the window does
+    FrameStats render(const std::vector<Mesh> &meshes, const Vec3D &cameraPos, double camAngleX, double camAngleY,
+                      const Vec3D &lightSource) {
+        {
+            PROFILE_SCOPE(ProfileStage::Clear);
+            framebuffer.clear(sf::Color::Magenta);
+            depthBuffer.clear();
+        }
+        ViewState view(cameraPos, camAngleX, camAngleY, framebuffer.getWidth(), framebuffer.getHeight());
+        FrameStats frameStats;
+        for (const auto &mesh : meshes) {rasterizeMesh(mesh, view, framebuffer, &depthBuffer, scratch, lightSource, renderOptions, &frameStats);}
+        return frameStats;
+    }
+};
+
+// value below which a fraction of the sorted times fall (nearest rank)
+static double getPercentile(const std::vector<double> &sorted, double fraction) {
+    size_t rank = static_cast<size_t>(std::ceil(fraction * sorted.size()));
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+static int runReplay(const HeadlessOptions &options, const std::vector<Mesh> &meshes) {
+    CameraPath path;
+    if (!loadCameraPath(options.cameraPathFile, path)) return 1;
+    int frameCount = options.frameCount;
+    if (frameCount == 0) frameCount = static_cast<int>(std::floor(path.getDuration() / options.timestep + 1e-9)) + 1;
+
+    // every frame is drawn at a fixed point on the path, so the frames (and the work in them) are the same on every
+    // run and every machine. only the time it takes changes
+    HeadlessTarget target(options.width, options.height);
+    std::vector<double> frameTimes;
+    frameTimes.reserve(frameCount);
+    FrameStats totalStats;
+    Profiler &profiler = getProfiler();
+    if (!options.profileFile.empty()) profiler.setEnabled(true);
+    // heap allocations in the first frame, which sets up the buffers the rest reuse, and in all the frames after it
+    uint64_t firstFrameAllocations = 0, laterAllocations = 0;
+    for (int frame = 0; frame < frameCount; frame++) {
+        CameraKeyframe pose = path.sample(frame * options.timestep);
+        Vec3D lightSource = options.lightFollowCamera ? pose.cameraPos : pose.hasLight ? pose.lightSource : options.lightSource;
+        uint64_t allocationsBefore = getAllocationCount();
+        auto start = std::chrono::steady_clock::now();
+        FrameStats frameStats = target.render(meshes, pose.cameraPos, pose.camAngleX, pose.camAngleY, lightSource);
+        frameTimes.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        (frame == 0 ? firstFrameAllocations : laterAllocations) += getAllocationCount() - allocationsBefore;
+        totalStats += frameStats;
+        profiler.addFrameStats(frameStats);
+        profiler.addTime(ProfileStage::Frame, frameTimes.back());
+        profiler.endFrame();
+    }
+
+    if (!options.profileFile.empty() && !profiler.writeJson(options.profileFile)) {
+        std::cerr << "can't write profile '" << options.profileFile << "'" << std::endl;
+        return 1;
+    }
+
+    if (!options.outputFile.empty() && !writeImage(target.framebuffer, options.outputFile)) {
+        std::cerr << "can't write image '" << options.outputFile << "'" << std::endl;
+        return 1;
+    }
+
+    double total = 0;
+    for (double time : frameTimes) total += time;
+    std::vector<double> sorted = frameTimes;
+    std::sort(sorted.begin(), sorted.end());
+    std::cout << "Replayed " << options.cameraPathFile << ": " << frameCount << " frames at " << options.width << "x"
+              << options.height << ", " << totalStats.trianglesTotal / frameCount << " triangles per frame ("
+              << getCoverageKernelName() << " coverage, " << getProjectionKernelName() << " projection, "
+              << getThreadPool().getThreadCount() << " threads)\n";
+    std::cout << "frame time (ms): mean " << total / frameCount << "  p50 " << getPercentile(sorted, 0.50) << "  p95 "
+              << getPercentile(sorted, 0.95) << "  p99 " << getPercentile(sorted, 0.99) << "  max " << sorted.back()
+              << "\n";
+    if (ALLOCATION_COUNTING) {
+        std::cout << "heap allocations: " << firstFrameAllocations << " in the first frame, " << laterAllocations
+                  << " in the " << frameCount - 1 << " frames after it\n";
+    }
+    return 0;
+}
+
+static int renderHeadless(const HeadlessOptions &options) {
+    std::vector<Mesh> meshes;
+    for (const auto &file : options.meshFiles) {
+        meshes.push_back(loadMeshFromFile(file));
+        if (meshes.back().getTriangleCount() == 0) {
+            std::cerr << "no triangles loaded from '" << file << "'" << std::endl;
+            return 1;
+        }
+    }
+    if (options.meshFormat != MeshFormat::Double) {
+        size_t before = 0, after = 0, triangles = 0;
+        for (auto &mesh : meshes) {
+            before += mesh.getMemoryUsage();
+            mesh = compactMesh(mesh, options.meshFormat);
+            after += mesh.getMemoryUsage();
+            triangles += mesh.getTriangleCount();
+        }
+        std::cout << "Stored the meshes as " << getMeshFormatName(options.meshFormat) << ": "
+                  << static_cast<double>(after) / triangles << " bytes per triangle (was "
+                  << static_cast<double>(before) / triangles << ")\n";
+    }
+    if (!options.cameraPathFile.empty()) return runReplay(options, meshes);
+
+    // same background and settings as the window, so both render the same image
+    HeadlessTarget target(options.width, options.height);
+    Vec3D lightSource = options.lightFollowCamera ? options.cameraPos : options.lightSource;
+    auto start = std::chrono::steady_clock::now();
+    FrameStats frameStats = target.render(meshes, options.cameraPos, options.camAngleX, options.camAngleY, lightSource);
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    if (!writeImage(target.framebuffer, options.outputFile)) {
+        std::cerr << "can't write image '" << options.outputFile << "'" << std::endl;
+        return 1;
+    }
+    std::cout << "Rendered " << frameStats.trianglesTotal << " triangles (" << frameStats.backfaceCulled
+              << " backfacing, " << frameStats.hiZRejected << " hidden) at " << options.width << "x" << options.height
+              << " in " << milliseconds << " ms to " << options.outputFile << "\n";
+    return 0;
+}
+
+int runHeadless(const HeadlessOptions &options) {
+    setTraceThreadName("main");
+    if (options.traceFile.empty()) return renderHeadless(options);
+
+    getTracer().startCapture();
+    int result = renderHeadless(options);
+    if (!getTracer().stopCapture(options.traceFile)) {
+        std::cerr << "can't write trace '" << options.traceFile << "'" << std::endl;
+        return 1;
+    }
+    return result;
+}
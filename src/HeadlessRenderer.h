@@ -0,0 +1,50 @@
+//
+// Created by Cooper Stevens on 3/12/25.
+//
+
+#ifndef HEADLESSRENDERER_H
+#define HEADLESSRENDERER_H
+
+#include <string>
+#include <vector>
+#include "LinAlg.h"
+#include "Mesh.h"
+
+// everything a render without a window needs, normally filled in from the command line
+struct HeadlessOptions {
+    std::vector<std::string> meshFiles;
+    // the meshes are converted to this after loading (see compactMesh())
+    MeshFormat meshFormat = MeshFormat::Double;
+    Vec3D cameraPos = Vec3D(0, 0, -3);
+    // radians, like ViewState (camAngleX is the pitch and camAngleY the yaw)
+    double camAngleX = 0;
+    double camAngleY = 0;
+    Vec3D lightSource = Vec3D(150, 150, -200);
+    bool lightFollowCamera = false;
+    int width = 1100;
+    int height = 800;
+    // .ppm or .png (see writeImage()). optional when replaying a camera path, where it gets the last frame
+    std::string outputFile;
+    // replays this camera path (see loadCameraPath()) as a benchmark instead of rendering one frame
+    std::string cameraPathFile;
+    // frames to render along the path, timestep seconds apart. 0 means as many as it takes to reach the end
+    int frameCount = 0;
+    double timestep = 1.0 / 60.0;
+    // writes the profiler's per-stage summary of the replay here (see Profiler::writeJson())
+    std::string profileFile;
+    // captures a timeline of the whole run, from loading the meshes on, here (see Tracer.h)
+    std::string traceFile;
+    bool showHelp = false;
+};
+
+// reads options from the program's arguments (see printHeadlessUsage()). prints what's wrong and returns false if
+// they can't be used
+bool parseHeadlessOptions(int argc, char *argv[], HeadlessOptions &options);
+
+void printHeadlessUsage(const char *program);
+
+// loads the meshes, renders one frame offscreen and writes it to options.outputFile, or replays options.cameraPathFile
+// and prints frame time statistics. never opens a window or reads from std::cin. returns the exit code for main()
+int runHeadless(const HeadlessOptions &options);
+
+#endif
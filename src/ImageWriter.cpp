@@ -0,0 +1,39 @@
+//
+// Created by Cooper Stevens on 3/12/25.
+//
+
+#include "ImageWriter.h"
+
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+// ppm is simple enough to write by hand, and it's what most tools in a pipeline can read without any libraries
+static bool writePPM(const Framebuffer &framebuffer, const std::string &filename) {
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) return false;
+    int width = framebuffer.getWidth();
+    int height = framebuffer.getHeight();
+    out << "P6\n" << width << " " << height << "\n255\n";
+
+    // RGBA to RGB, one row at a time
+    const sf::Uint8 *pixels = framebuffer.getBytes();
+    std::vector<char> row(3 * static_cast<size_t>(width));
+    for (int y = 0; y < height; y++) {
+        const sf::Uint8 *source = pixels + 4 * static_cast<size_t>(y) * framebuffer.getPitch();
+        for (int x = 0; x < width; x++) {
+            row[3 * x] = static_cast<char>(source[4 * x]);
+            row[3 * x + 1] = static_cast<char>(source[4 * x + 1]);
+            row[3 * x + 2] = static_cast<char>(source[4 * x + 2]);
+        }
+        out.write(row.data(), static_cast<std::streamsize>(row.size()));
+    }
+    return static_cast<bool>(out);
+}
+
+bool writeImage(const Framebuffer &framebuffer, const std::string &filename) {
+    if (std::filesystem::path(filename).extension() == ".ppm") return writePPM(framebuffer, filename);
+    sf::Image image;
+    framebuffer.copyToImage(image);
+    return image.saveToFile(filename);
+}
@@ -0,0 +1,17 @@
+//
+// Created by Cooper Stevens on 3/12/25.
+//
+
+#ifndef IMAGEWRITER_H
+#define IMAGEWRITER_H
+
+#include <string>
+#include "Framebuffer.h"
+
+// saves a rendered frame. the format comes from the extension: .ppm is written as a binary (P6) ppm, anything else
+// (.png, .bmp, .tga, .jpg) is copied into an sf::Image and goes through sf::Image::saveToFile. neither needs a window
+// or a display.
+// returns false if the file can't be written
+bool writeImage(const Framebuffer &framebuffer, const std::string &filename);
+
+#endif
@@ -3,9 +3,14 @@
 //
 
 #include "InputHandler.h"
-#include <fstream>
+#include <algorithm>
+#include <cctype>
 #include <iostream>
-#include <sstream>
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "MeshParser.h"
+#include "ObjParser.h"
+#include "Tracer.h"
 namespace fs = std::filesystem;
 
 double getMoveSpeed() {
@@ -40,6 +45,13 @@ bool lightingPrompt() {
     return (response == 'y');
 }
 
+bool hasExtension(const std::filesystem::path &path, std::string_view extension) {
+    std::string actual = path.extension().string();
+    return std::equal(actual.begin(), actual.end(), extension.begin(), extension.end(), [](char a, char b) {
+        return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+    });
+}
+
 std::string getFileInput() {
 
     std::string path = "../inputs";
@@ -48,7 +60,8 @@ std::string getFileInput() {
 
     // Iterate over the files in the directory
     for (const auto &entry : fs::directory_iterator(path)) {
-        if (entry.is_regular_file()) {
+        // skip the binary caches loadMeshFromFile() leaves next to the meshes
+        if (entry.is_regular_file() && !hasExtension(entry.path(), ".rmesh") && !hasExtension(entry.path(), ".tmp")) {
             files.push_back(entry.path().filename().string());
         }
     }
@@ -82,53 +95,62 @@ std::string getFileInput() {
 
 
 Mesh loadMeshFromFile(const std::string& filename) {
-    std::vector<Triangle3D> triangles;
-
-    std::ifstream infile(filename);
-    if (!infile.is_open()) {
+    TRACE_SCOPE("load");
+    // map the whole file, it's either hashed to check the cache or parsed in place
+    MappedFile file;
+    if (!file.open(filename)) {
         std::cerr << "can't open file '" << filename << "'." << std::endl;
-        return Mesh(triangles);
+        return Mesh();
     }
 
-    std::string line;
-    int lineNumber = 0;
-    bool apply =false;
-
-    Vec3D t = Vec3D(0,0,0);
-    while (std::getline(infile, line)) {
-        ++lineNumber;
-        // remove whitespace
-        line.erase(0, line.find_first_not_of(" \t\r\n"));
-        line.erase(line.find_last_not_of(" \t\r\n") + 1);
-        std::istringstream l(line);
-
-        if (line[0] == '!') {apply = true; continue;}
-
-        // skip empty lines
-        if (line.empty() || line[0] == '#') continue;
-
+    // use the binary cache from an earlier run if it was made from this exact file
+    std::string cachePath = getMeshCachePath(filename);
+    MeshSourceInfo source = getMeshSourceInfo(filename, file.data(), file.size());
+    Mesh mesh;
+    if (loadMeshCache(cachePath, source, mesh)) {
+        std::cout << "Loaded " << mesh.getTriangleCount() << " triangles and " << mesh.getVertexCount()
+                  << " vertices from " << cachePath << "\n";
+        return mesh;
+    }
 
-        double x1, y1, z1;
-        double x2, y2, z2;
-        double x3, y3, z3;
-        if (!(l >> x1 >> y1 >> z1 >> x2 >> y2 >> z2 >> x3 >> y3 >> z3)) {
-            std::cerr << "(debug) invalid triangle format at line " << lineNumber << ": " << line << std::endl;
-            continue;
+    bool apply = false;
+    Vec3D translation;
+    if (hasExtension(filename, ".obj")) {
+        // obj files are streamed in blocks instead of parsed in place, so the mapping isn't needed any more
+        file.close();
+        MeshData data;
+        ObjInfo info;
+        if (!parseObjFile(filename, data, info)) {
+            std::cerr << "can't read file '" << filename << "'." << std::endl;
+            return Mesh();
         }
-        Vec3D a(x1, y1, z1);
-        Vec3D b(x2, y2, z2);
-        Vec3D c(x3, y3, z3);
-
-        triangles.push_back(Triangle3D(a,b,c));
+        mesh = Mesh(std::move(data));
+        std::cout << "Loaded " << mesh.getTriangleCount() << " triangles and " << mesh.getVertexCount()
+                  << " vertices from " << filename << " (" << info.faceCount << " faces)\n";
+    } else {
+        // corners shared between triangles are welded into one vertex as the file is read
+        MeshBuilder builder;
+        MeshTextInfo info = parseMeshText(file.data(), file.data() + file.size(), builder);
+        apply = info.fixNormals;
+        translation = info.translation;
+
+        size_t corners = builder.getCornerCount();
+        size_t vertices = builder.getVertexCount();
+        mesh = builder.build();
+        std::cout << "Loaded " << mesh.getTriangleCount() << " triangles from " << filename << ": " << corners
+                  << " corners welded into " << vertices << " vertices";
+        if (vertices > 0) std::cout << " (" << static_cast<double>(corners) / vertices << "x fewer)";
+        std::cout << "\n";
     }
-    infile.close();
-    Mesh mesh(triangles);
 
     if (apply) {ensureNormalsFaceOutward(mesh);}
-    if (filename == "../inputs/remy.txt") mesh.translate(Vec3D(0,-200,300));
+    // the offset comes from the file itself, so it's part of what the cache's hash covers
+    if (translation != Vec3D()) mesh.translate(translation);
 
+    // the cache holds the finished mesh, so none of the above has to be redone next time
+    if (!writeMeshCache(cachePath, source, mesh)) {
+        std::cerr << "(debug) couldn't write mesh cache '" << cachePath << "'" << std::endl;
+    }
 
     return mesh;
 }
-
-
@@ -4,6 +4,8 @@
 
 #ifndef IOHANDLER_H
 #define IOHANDLER_H
+#include <filesystem>
+#include <string_view>
 #include "LinAlg.h"
 #include "Rasterizer.h"
 
@@ -15,6 +17,9 @@ bool lightingPrompt();
 
 std::string getFileInput();
 
+// whether path ends in extension (like ".obj"), ignoring case, since exporters often write MODEL.OBJ
+bool hasExtension(const std::filesystem::path &path, std::string_view extension);
+
 Mesh loadMeshFromFile(const std::string& filename);
 #endif
 
@@ -6,11 +6,22 @@
 
 #include <iostream>
 
+#include "CpuFeatures.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LINALG_X86 1
+#endif
+
+// the 4 wide types fill a simd register exactly, and the math works at compile time
+static_assert(sizeof(Vec4F) == 16 && alignof(Vec4F) == 16);
+static_assert(sizeof(Matrix4x4) == 128 && alignof(Matrix4x4) == 32);
+static_assert(Vec3D(1, 0, 0).cross(Vec3D(0, 1, 0)) == Vec3D(0, 0, 1));
+
 // generates a perspective projection matrix
 // a perspective projection matrix is a linear operator that will allow us to project a 3d point into 2d space
 // fov in radians
-Matrix4x4 getPerspectiveProjectionMatrix(const double &fov, const sf::Image &image, double nearPlane, double farPlane) {
-    double ar = static_cast<double>(image.getSize().x) / image.getSize().y;
+Matrix4x4 getPerspectiveProjectionMatrix(const double &fov, double ar, double nearPlane, double farPlane) {
     double scale = 1.0 / tan(fov * 0.5);
     double nf = 1.0 / (nearPlane - farPlane);
 
@@ -22,42 +33,351 @@ Matrix4x4 getPerspectiveProjectionMatrix(const double &fov, const sf::Image &ima
     };
 }
 
-Vec2D getProjectedVector(const Vec3D &v, const sf::Image &image, const Vec3D &cameraPos, double camAngleX, double camAngleY) {
+ViewState::ViewState(const Vec3D &cameraPos, double camAngleX, double camAngleY, int width, int height)
+    : cameraPos(cameraPos), camAngleX(camAngleX), camAngleY(camAngleY), width(width), height(height),
+      halfWidth(0.5 * width), halfHeight(0.5 * height) {
     Matrix3x3 combineRotations =  (
         Matrix3x3(Vec3D(1,0,0),Vec3D(0,cos(camAngleX),sin(camAngleX)), Vec3D(0,-sin(camAngleX),cos(camAngleX)))
         *
         Matrix3x3(Vec3D(cos(camAngleY),0,-sin(camAngleY)),Vec3D(0,1,0), Vec3D(sin(camAngleY),0,cos(camAngleY))));
+    // flip y to match the screen (pixels lower on the screen are indexed higher)
+    Matrix3x3 rotation = Matrix3x3(Vec3D(1,0,0), Vec3D(0,-1,0), Vec3D(0,0,1)) * combineRotations;
+
+    // shifts v to reframe the space as if the camera were at the origin, then rotates it. as a 4x4 matrix the
+    // translation ends up in the last column
+    Vec3D translation = rotation * (cameraPos * -1.0);
+    Matrix4x4 view(
+        Vec4D(rotation.c1.x, rotation.c1.y, rotation.c1.z, 0),
+        Vec4D(rotation.c2.x, rotation.c2.y, rotation.c2.z, 0),
+        Vec4D(rotation.c3.x, rotation.c3.y, rotation.c3.z, 0),
+        Vec4D(translation.x, translation.y, translation.z, 1)
+    );
 
     double nearPlane = 0.001;
     double farPlane = 1000.0;
-    Matrix4x4 projectionMatrix = getPerspectiveProjectionMatrix(M_PI / 4, image, nearPlane, farPlane);
+    Matrix4x4 projectionMatrix = getPerspectiveProjectionMatrix(M_PI / 4, static_cast<double>(width) / height, nearPlane, farPlane);
+
+    viewProjection = projectionMatrix * view;
+}
+
+Vec3D getProjectedPoint(const Vec3D &v, const ViewState &view) {
+    return view.project(v);
+}
+
+Vec2D getProjectedVector(const Vec3D &v, const ViewState &view) {
+    Vec3D projected = view.project(v);
+    return {projected.x, projected.y};
+}
+
+
+//
+////
+// BATCH PROJECTION
+////
+//
+
+// every kernel does the same double operations in the same order as ViewState::project(): the matrix rows are summed
+// left to right, then the w clamp, one division, the viewport mapping and the clamp to the screen. none of them are
+// compiled with fma enabled, so nothing gets fused and rounded differently
+
+using ProjectionKernel = void (*)(const ViewState &, const double *, const double *, const double *, size_t,
+                                  double *, double *, double *);
+
+// the float kernels do the same in float and widen the screen coordinates to double as they store them
+using FloatProjectionKernel = void (*)(const ViewState &, const Matrix4x4F &, const float *, const float *,
+                                       const float *, size_t, double *, double *, double *);
+
+static void projectPointsScalar(const ViewState &view, const double *x, const double *y, const double *z, size_t count,
+                                double *screenX, double *screenY, double *screenZ) {
+    for (size_t i = 0; i < count; i++) {
+        Vec3D projected = view.project(Vec3D(x[i], y[i], z[i]));
+        screenX[i] = projected.x;
+        screenY[i] = projected.y;
+        screenZ[i] = projected.z;
+    }
+}
+
+static void projectPointsFloatScalar(const ViewState &view, const Matrix4x4F &toClip, const float *x, const float *y,
+                                     const float *z, size_t count, double *screenX, double *screenY, double *screenZ) {
+    for (size_t i = 0; i < count; i++) {
+        Vec3F projected = view.project(toClip, Vec3F(x[i], y[i], z[i]));
+        screenX[i] = projected.x;
+        screenY[i] = projected.y;
+        screenZ[i] = projected.z;
+    }
+}
+
+#ifdef LINALG_X86
+
+__attribute__((target("sse2")))
+static void projectPointsSSE2(const ViewState &view, const double *x, const double *y, const double *z, size_t count,
+                              double *screenX, double *screenY, double *screenZ) {
+    const Matrix4x4 &m = view.viewProjection;
+    const __m128d m1x = _mm_set1_pd(m.c1.x), m2x = _mm_set1_pd(m.c2.x), m3x = _mm_set1_pd(m.c3.x), m4x = _mm_set1_pd(m.c4.x);
+    const __m128d m1y = _mm_set1_pd(m.c1.y), m2y = _mm_set1_pd(m.c2.y), m3y = _mm_set1_pd(m.c3.y), m4y = _mm_set1_pd(m.c4.y);
+    const __m128d m1w = _mm_set1_pd(m.c1.w), m2w = _mm_set1_pd(m.c2.w), m3w = _mm_set1_pd(m.c3.w), m4w = _mm_set1_pd(m.c4.w);
+    const __m128d signBit = _mm_set1_pd(-0.0);
+    const __m128d minW = _mm_set1_pd(0.0001);
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128d halfWidth = _mm_set1_pd(view.halfWidth), halfHeight = _mm_set1_pd(view.halfHeight);
+    const __m128d width = _mm_set1_pd(view.width), height = _mm_set1_pd(view.height);
+    const __m128d zero = _mm_setzero_pd();
+
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128d px = _mm_loadu_pd(x + i), py = _mm_loadu_pd(y + i), pz = _mm_loadu_pd(z + i);
+
+        // clip space
+        __m128d cx = _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(m1x, px), _mm_mul_pd(m2x, py)), _mm_mul_pd(m3x, pz)), m4x);
+        __m128d cy = _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(m1y, px), _mm_mul_pd(m2y, py)), _mm_mul_pd(m3y, pz)), m4y);
+        __m128d cw = _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(m1w, px), _mm_mul_pd(m2w, py)), _mm_mul_pd(m3w, pz)), m4w);
+
+        // screen space
+        __m128d tiny = _mm_cmplt_pd(_mm_andnot_pd(signBit, cw), minW);
+        cw = _mm_or_pd(_mm_and_pd(tiny, minW), _mm_andnot_pd(tiny, cw));
+        __m128d invW = _mm_div_pd(one, cw);
+        __m128d sx = _mm_mul_pd(_mm_add_pd(_mm_mul_pd(cx, invW), one), halfWidth);
+        __m128d sy = _mm_mul_pd(_mm_sub_pd(one, _mm_mul_pd(cy, invW)), halfHeight);
+        _mm_storeu_pd(screenX + i, _mm_max_pd(_mm_min_pd(width, sx), zero));
+        _mm_storeu_pd(screenY + i, _mm_max_pd(_mm_min_pd(height, sy), zero));
+        _mm_storeu_pd(screenZ + i, _mm_xor_pd(invW, signBit));
+    }
+    projectPointsScalar(view, x + i, y + i, z + i, count - i, screenX + i, screenY + i, screenZ + i);
+}
+
+__attribute__((target("sse2")))
+static void projectPointsFloatSSE2(const ViewState &view, const Matrix4x4F &m, const float *x, const float *y,
+                                   const float *z, size_t count, double *screenX, double *screenY, double *screenZ) {
+    const __m128 m1x = _mm_set1_ps(m.c1.x), m2x = _mm_set1_ps(m.c2.x), m3x = _mm_set1_ps(m.c3.x), m4x = _mm_set1_ps(m.c4.x);
+    const __m128 m1y = _mm_set1_ps(m.c1.y), m2y = _mm_set1_ps(m.c2.y), m3y = _mm_set1_ps(m.c3.y), m4y = _mm_set1_ps(m.c4.y);
+    const __m128 m1w = _mm_set1_ps(m.c1.w), m2w = _mm_set1_ps(m.c2.w), m3w = _mm_set1_ps(m.c3.w), m4w = _mm_set1_ps(m.c4.w);
+    const __m128 signBit = _mm_set1_ps(-0.0f);
+    const __m128 minW = _mm_set1_ps(0.0001f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 halfWidth = _mm_set1_ps(static_cast<float>(view.halfWidth));
+    const __m128 halfHeight = _mm_set1_ps(static_cast<float>(view.halfHeight));
+    const __m128 width = _mm_set1_ps(static_cast<float>(view.width)), height = _mm_set1_ps(static_cast<float>(view.height));
+    const __m128 zero = _mm_setzero_ps();
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 px = _mm_loadu_ps(x + i), py = _mm_loadu_ps(y + i), pz = _mm_loadu_ps(z + i);
 
-    // shifts v to reframe the space as if the camera were at the origin
-    Vec3D cameraRelativePosition = v - cameraPos;
+        // clip space
+        __m128 cx = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m1x, px), _mm_mul_ps(m2x, py)), _mm_mul_ps(m3x, pz)), m4x);
+        __m128 cy = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m1y, px), _mm_mul_ps(m2y, py)), _mm_mul_ps(m3y, pz)), m4y);
+        __m128 cw = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m1w, px), _mm_mul_ps(m2w, py)), _mm_mul_ps(m3w, pz)), m4w);
 
-    cameraRelativePosition = combineRotations*cameraRelativePosition;
-    cameraRelativePosition = Matrix3x3(Vec3D(1,0,0), Vec3D(0,-1,0), Vec3D(0,0,1)) * cameraRelativePosition;
-    // extend to 4d
-    Vec4D extendedVector(cameraRelativePosition.x, cameraRelativePosition.y, cameraRelativePosition.z, 1.0);
+        // screen space
+        __m128 tiny = _mm_cmplt_ps(_mm_andnot_ps(signBit, cw), minW);
+        cw = _mm_or_ps(_mm_and_ps(tiny, minW), _mm_andnot_ps(tiny, cw));
+        __m128 invW = _mm_div_ps(one, cw);
+        __m128 sx = _mm_max_ps(_mm_min_ps(width, _mm_mul_ps(_mm_add_ps(_mm_mul_ps(cx, invW), one), halfWidth)), zero);
+        __m128 sy = _mm_max_ps(_mm_min_ps(height, _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(cy, invW)), halfHeight)), zero);
+        __m128 sz = _mm_xor_ps(invW, signBit);
 
-    // apply transformation
-    Vec4D transformed = projectionMatrix * extendedVector;
+        // widened two at a time
+        _mm_storeu_pd(screenX + i, _mm_cvtps_pd(sx));
+        _mm_storeu_pd(screenX + i + 2, _mm_cvtps_pd(_mm_movehl_ps(sx, sx)));
+        _mm_storeu_pd(screenY + i, _mm_cvtps_pd(sy));
+        _mm_storeu_pd(screenY + i + 2, _mm_cvtps_pd(_mm_movehl_ps(sy, sy)));
+        _mm_storeu_pd(screenZ + i, _mm_cvtps_pd(sz));
+        _mm_storeu_pd(screenZ + i + 2, _mm_cvtps_pd(_mm_movehl_ps(sz, sz)));
+    }
+    projectPointsFloatScalar(view, m, x + i, y + i, z + i, count - i, screenX + i, screenY + i, screenZ + i);
+}
+
+__attribute__((target("avx2")))
+static void projectPointsAVX2(const ViewState &view, const double *x, const double *y, const double *z, size_t count,
+                              double *screenX, double *screenY, double *screenZ) {
+    const Matrix4x4 &m = view.viewProjection;
+    const __m256d m1x = _mm256_set1_pd(m.c1.x), m2x = _mm256_set1_pd(m.c2.x), m3x = _mm256_set1_pd(m.c3.x), m4x = _mm256_set1_pd(m.c4.x);
+    const __m256d m1y = _mm256_set1_pd(m.c1.y), m2y = _mm256_set1_pd(m.c2.y), m3y = _mm256_set1_pd(m.c3.y), m4y = _mm256_set1_pd(m.c4.y);
+    const __m256d m1w = _mm256_set1_pd(m.c1.w), m2w = _mm256_set1_pd(m.c2.w), m3w = _mm256_set1_pd(m.c3.w), m4w = _mm256_set1_pd(m.c4.w);
+    const __m256d signBit = _mm256_set1_pd(-0.0);
+    const __m256d minW = _mm256_set1_pd(0.0001);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d halfWidth = _mm256_set1_pd(view.halfWidth), halfHeight = _mm256_set1_pd(view.halfHeight);
+    const __m256d width = _mm256_set1_pd(view.width), height = _mm256_set1_pd(view.height);
+    const __m256d zero = _mm256_setzero_pd();
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d px = _mm256_loadu_pd(x + i), py = _mm256_loadu_pd(y + i), pz = _mm256_loadu_pd(z + i);
+
+        // clip space
+        __m256d cx = _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(m1x, px), _mm256_mul_pd(m2x, py)), _mm256_mul_pd(m3x, pz)), m4x);
+        __m256d cy = _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(m1y, px), _mm256_mul_pd(m2y, py)), _mm256_mul_pd(m3y, pz)), m4y);
+        __m256d cw = _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(m1w, px), _mm256_mul_pd(m2w, py)), _mm256_mul_pd(m3w, pz)), m4w);
+
+        // screen space
+        __m256d tiny = _mm256_cmp_pd(_mm256_andnot_pd(signBit, cw), minW, _CMP_LT_OQ);
+        cw = _mm256_blendv_pd(cw, minW, tiny);
+        __m256d invW = _mm256_div_pd(one, cw);
+        __m256d sx = _mm256_mul_pd(_mm256_add_pd(_mm256_mul_pd(cx, invW), one), halfWidth);
+        __m256d sy = _mm256_mul_pd(_mm256_sub_pd(one, _mm256_mul_pd(cy, invW)), halfHeight);
+        _mm256_storeu_pd(screenX + i, _mm256_max_pd(_mm256_min_pd(width, sx), zero));
+        _mm256_storeu_pd(screenY + i, _mm256_max_pd(_mm256_min_pd(height, sy), zero));
+        _mm256_storeu_pd(screenZ + i, _mm256_xor_pd(invW, signBit));
+    }
+    projectPointsScalar(view, x + i, y + i, z + i, count - i, screenX + i, screenY + i, screenZ + i);
+}
+
+__attribute__((target("avx2")))
+static void projectPointsFloatAVX2(const ViewState &view, const Matrix4x4F &m, const float *x, const float *y,
+                                   const float *z, size_t count, double *screenX, double *screenY, double *screenZ) {
+    const __m256 m1x = _mm256_set1_ps(m.c1.x), m2x = _mm256_set1_ps(m.c2.x), m3x = _mm256_set1_ps(m.c3.x), m4x = _mm256_set1_ps(m.c4.x);
+    const __m256 m1y = _mm256_set1_ps(m.c1.y), m2y = _mm256_set1_ps(m.c2.y), m3y = _mm256_set1_ps(m.c3.y), m4y = _mm256_set1_ps(m.c4.y);
+    const __m256 m1w = _mm256_set1_ps(m.c1.w), m2w = _mm256_set1_ps(m.c2.w), m3w = _mm256_set1_ps(m.c3.w), m4w = _mm256_set1_ps(m.c4.w);
+    const __m256 signBit = _mm256_set1_ps(-0.0f);
+    const __m256 minW = _mm256_set1_ps(0.0001f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 halfWidth = _mm256_set1_ps(static_cast<float>(view.halfWidth));
+    const __m256 halfHeight = _mm256_set1_ps(static_cast<float>(view.halfHeight));
+    const __m256 width = _mm256_set1_ps(static_cast<float>(view.width)), height = _mm256_set1_ps(static_cast<float>(view.height));
+    const __m256 zero = _mm256_setzero_ps();
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 px = _mm256_loadu_ps(x + i), py = _mm256_loadu_ps(y + i), pz = _mm256_loadu_ps(z + i);
+
+        // clip space
+        __m256 cx = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m1x, px), _mm256_mul_ps(m2x, py)), _mm256_mul_ps(m3x, pz)), m4x);
+        __m256 cy = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m1y, px), _mm256_mul_ps(m2y, py)), _mm256_mul_ps(m3y, pz)), m4y);
+        __m256 cw = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m1w, px), _mm256_mul_ps(m2w, py)), _mm256_mul_ps(m3w, pz)), m4w);
+
+        // screen space
+        __m256 tiny = _mm256_cmp_ps(_mm256_andnot_ps(signBit, cw), minW, _CMP_LT_OQ);
+        cw = _mm256_blendv_ps(cw, minW, tiny);
+        __m256 invW = _mm256_div_ps(one, cw);
+        __m256 sx = _mm256_max_ps(_mm256_min_ps(width, _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(cx, invW), one), halfWidth)), zero);
+        __m256 sy = _mm256_max_ps(_mm256_min_ps(height, _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(cy, invW)), halfHeight)), zero);
+        __m256 sz = _mm256_xor_ps(invW, signBit);
+
+        // widened four at a time
+        _mm256_storeu_pd(screenX + i, _mm256_cvtps_pd(_mm256_castps256_ps128(sx)));
+        _mm256_storeu_pd(screenX + i + 4, _mm256_cvtps_pd(_mm256_extractf128_ps(sx, 1)));
+        _mm256_storeu_pd(screenY + i, _mm256_cvtps_pd(_mm256_castps256_ps128(sy)));
+        _mm256_storeu_pd(screenY + i + 4, _mm256_cvtps_pd(_mm256_extractf128_ps(sy, 1)));
+        _mm256_storeu_pd(screenZ + i, _mm256_cvtps_pd(_mm256_castps256_ps128(sz)));
+        _mm256_storeu_pd(screenZ + i + 4, _mm256_cvtps_pd(_mm256_extractf128_ps(sz, 1)));
+    }
+    projectPointsFloatScalar(view, m, x + i, y + i, z + i, count - i, screenX + i, screenY + i, screenZ + i);
+}
+
+// avx512f turns on fma, so the multiplies and adds use the explicit rounding versions, which the compiler won't fuse
+__attribute__((target("avx512f")))
+static void projectPointsAVX512(const ViewState &view, const double *x, const double *y, const double *z, size_t count,
+                                double *screenX, double *screenY, double *screenZ) {
+    const int r = _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC;
+    const Matrix4x4 &m = view.viewProjection;
+    const __m512d m1x = _mm512_set1_pd(m.c1.x), m2x = _mm512_set1_pd(m.c2.x), m3x = _mm512_set1_pd(m.c3.x), m4x = _mm512_set1_pd(m.c4.x);
+    const __m512d m1y = _mm512_set1_pd(m.c1.y), m2y = _mm512_set1_pd(m.c2.y), m3y = _mm512_set1_pd(m.c3.y), m4y = _mm512_set1_pd(m.c4.y);
+    const __m512d m1w = _mm512_set1_pd(m.c1.w), m2w = _mm512_set1_pd(m.c2.w), m3w = _mm512_set1_pd(m.c3.w), m4w = _mm512_set1_pd(m.c4.w);
+    const __m512i signBit = _mm512_set1_epi64(static_cast<long long>(0x8000000000000000ull));
+    const __m512d minW = _mm512_set1_pd(0.0001);
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d halfWidth = _mm512_set1_pd(view.halfWidth), halfHeight = _mm512_set1_pd(view.halfHeight);
+    const __m512d width = _mm512_set1_pd(view.width), height = _mm512_set1_pd(view.height);
+    const __m512d zero = _mm512_setzero_pd();
 
-    // ensure no division by zero
-    if (std::abs(transformed.w) < 0.0001) {
-        transformed.w = 0.0001;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m512d px = _mm512_loadu_pd(x + i), py = _mm512_loadu_pd(y + i), pz = _mm512_loadu_pd(z + i);
+
+        // clip space
+        __m512d cx = _mm512_add_round_pd(_mm512_add_round_pd(_mm512_add_round_pd(_mm512_mul_round_pd(m1x, px, r), _mm512_mul_round_pd(m2x, py, r), r), _mm512_mul_round_pd(m3x, pz, r), r), m4x, r);
+        __m512d cy = _mm512_add_round_pd(_mm512_add_round_pd(_mm512_add_round_pd(_mm512_mul_round_pd(m1y, px, r), _mm512_mul_round_pd(m2y, py, r), r), _mm512_mul_round_pd(m3y, pz, r), r), m4y, r);
+        __m512d cw = _mm512_add_round_pd(_mm512_add_round_pd(_mm512_add_round_pd(_mm512_mul_round_pd(m1w, px, r), _mm512_mul_round_pd(m2w, py, r), r), _mm512_mul_round_pd(m3w, pz, r), r), m4w, r);
+
+        // screen space
+        __mmask8 tiny = _mm512_cmp_pd_mask(_mm512_abs_pd(cw), minW, _CMP_LT_OQ);
+        cw = _mm512_mask_blend_pd(tiny, cw, minW);
+        __m512d invW = _mm512_div_pd(one, cw);
+        __m512d sx = _mm512_mul_round_pd(_mm512_add_round_pd(_mm512_mul_round_pd(cx, invW, r), one, r), halfWidth, r);
+        __m512d sy = _mm512_mul_round_pd(_mm512_sub_round_pd(one, _mm512_mul_round_pd(cy, invW, r), r), halfHeight, r);
+        _mm512_storeu_pd(screenX + i, _mm512_max_pd(_mm512_min_pd(width, sx), zero));
+        _mm512_storeu_pd(screenY + i, _mm512_max_pd(_mm512_min_pd(height, sy), zero));
+        _mm512_storeu_pd(screenZ + i, _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(invW), signBit)));
+    }
+    projectPointsScalar(view, x + i, y + i, z + i, count - i, screenX + i, screenY + i, screenZ + i);
+}
+
+__attribute__((target("avx512f")))
+static void projectPointsFloatAVX512(const ViewState &view, const Matrix4x4F &m, const float *x, const float *y,
+                                     const float *z, size_t count, double *screenX, double *screenY, double *screenZ) {
+    const int r = _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC;
+    const __m512 m1x = _mm512_set1_ps(m.c1.x), m2x = _mm512_set1_ps(m.c2.x), m3x = _mm512_set1_ps(m.c3.x), m4x = _mm512_set1_ps(m.c4.x);
+    const __m512 m1y = _mm512_set1_ps(m.c1.y), m2y = _mm512_set1_ps(m.c2.y), m3y = _mm512_set1_ps(m.c3.y), m4y = _mm512_set1_ps(m.c4.y);
+    const __m512 m1w = _mm512_set1_ps(m.c1.w), m2w = _mm512_set1_ps(m.c2.w), m3w = _mm512_set1_ps(m.c3.w), m4w = _mm512_set1_ps(m.c4.w);
+    const __m512i signBit = _mm512_set1_epi32(static_cast<int>(0x80000000u));
+    const __m512 minW = _mm512_set1_ps(0.0001f);
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __m512 halfWidth = _mm512_set1_ps(static_cast<float>(view.halfWidth));
+    const __m512 halfHeight = _mm512_set1_ps(static_cast<float>(view.halfHeight));
+    const __m512 width = _mm512_set1_ps(static_cast<float>(view.width)), height = _mm512_set1_ps(static_cast<float>(view.height));
+    const __m512 zero = _mm512_setzero_ps();
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512 px = _mm512_loadu_ps(x + i), py = _mm512_loadu_ps(y + i), pz = _mm512_loadu_ps(z + i);
+
+        // clip space
+        __m512 cx = _mm512_add_round_ps(_mm512_add_round_ps(_mm512_add_round_ps(_mm512_mul_round_ps(m1x, px, r), _mm512_mul_round_ps(m2x, py, r), r), _mm512_mul_round_ps(m3x, pz, r), r), m4x, r);
+        __m512 cy = _mm512_add_round_ps(_mm512_add_round_ps(_mm512_add_round_ps(_mm512_mul_round_ps(m1y, px, r), _mm512_mul_round_ps(m2y, py, r), r), _mm512_mul_round_ps(m3y, pz, r), r), m4y, r);
+        __m512 cw = _mm512_add_round_ps(_mm512_add_round_ps(_mm512_add_round_ps(_mm512_mul_round_ps(m1w, px, r), _mm512_mul_round_ps(m2w, py, r), r), _mm512_mul_round_ps(m3w, pz, r), r), m4w, r);
+
+        // screen space
+        __mmask16 tiny = _mm512_cmp_ps_mask(_mm512_abs_ps(cw), minW, _CMP_LT_OQ);
+        cw = _mm512_mask_blend_ps(tiny, cw, minW);
+        __m512 invW = _mm512_div_ps(one, cw);
+        __m512 sx = _mm512_max_ps(_mm512_min_ps(width, _mm512_mul_round_ps(_mm512_add_round_ps(_mm512_mul_round_ps(cx, invW, r), one, r), halfWidth, r)), zero);
+        __m512 sy = _mm512_max_ps(_mm512_min_ps(height, _mm512_mul_round_ps(_mm512_sub_round_ps(one, _mm512_mul_round_ps(cy, invW, r), r), halfHeight, r)), zero);
+        __m512 sz = _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(invW), signBit));
+
+        // widened eight at a time. the shuffle moves the upper eight floats down
+        const int upper = _MM_SHUFFLE(3, 2, 3, 2);
+        _mm512_storeu_pd(screenX + i, _mm512_cvtps_pd(_mm512_castps512_ps256(sx)));
+        _mm512_storeu_pd(screenX + i + 8, _mm512_cvtps_pd(_mm512_castps512_ps256(_mm512_shuffle_f32x4(sx, sx, upper))));
+        _mm512_storeu_pd(screenY + i, _mm512_cvtps_pd(_mm512_castps512_ps256(sy)));
+        _mm512_storeu_pd(screenY + i + 8, _mm512_cvtps_pd(_mm512_castps512_ps256(_mm512_shuffle_f32x4(sy, sy, upper))));
+        _mm512_storeu_pd(screenZ + i, _mm512_cvtps_pd(_mm512_castps512_ps256(sz)));
+        _mm512_storeu_pd(screenZ + i + 8, _mm512_cvtps_pd(_mm512_castps512_ps256(_mm512_shuffle_f32x4(sz, sz, upper))));
     }
+    projectPointsFloatScalar(view, m, x + i, y + i, z + i, count - i, screenX + i, screenY + i, screenZ + i);
+}
+
+#endif
+
+struct ProjectionKernelEntry {
+    const char *name;
+    ProjectionKernel kernel;
+    FloatProjectionKernel floatKernel;
+};
 
-    if (std::abs(transformed.w) < 1e-6) transformed.w = 1e-6;
-    double x = transformed.x /transformed.w;
-    double y = transformed.y / transformed.w;
+// widest kernel the cpu supports, chosen once at startup
+static ProjectionKernelEntry pickProjectionKernel() {
+#ifdef LINALG_X86
+    const CpuFeatures &cpu = getCpuFeatures();
+    if (cpu.avx512) return {"avx512", projectPointsAVX512, projectPointsFloatAVX512};
+    if (cpu.avx2) return {"avx2", projectPointsAVX2, projectPointsFloatAVX2};
+    if (cpu.sse2) return {"sse2", projectPointsSSE2, projectPointsFloatSSE2};
+#endif
+    return {"scalar", projectPointsScalar, projectPointsFloatScalar};
+}
+
+static ProjectionKernelEntry projectionKernel = pickProjectionKernel();
 
-    // normalized device coordinates to screen space
-    double screenX = (x + 1.0) * 0.5 * image.getSize().x;
-    double screenY = (1.0 - y) * 0.5 * image.getSize().y;
-    screenX = std::max(0.0, std::min(screenX, static_cast<double>(image.getSize().x - 1)));
-    screenY = std::max(0.0, std::min(screenY, static_cast<double>(image.getSize().y - 1)));
+void projectPoints(const ViewState &view, const double *x, const double *y, const double *z, size_t count,
+                   double *screenX, double *screenY, double *screenZ) {
+    projectionKernel.kernel(view, x, y, z, count, screenX, screenY, screenZ);
+}
 
-    return {screenX, screenY};
+void projectPoints(const ViewState &view, const Matrix4x4F &toClip, const float *x, const float *y, const float *z,
+                   size_t count, double *screenX, double *screenY, double *screenZ) {
+    projectionKernel.floatKernel(view, toClip, x, y, z, count, screenX, screenY, screenZ);
 }
 
+const char *getProjectionKernelName() {
+    return projectionKernel.name;
+}
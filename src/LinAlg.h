@@ -5,7 +5,10 @@
 #ifndef LINALG_H
 #define LINALG_H
 
+#include <algorithm>
 #include <cmath>
+#include <string>
+#include <vector>
 #include <SFML/Graphics.hpp>
 
 //
@@ -14,65 +17,81 @@
 ////
 //
 
-
-struct Vec2D {
-    double x,y;
-    Vec2D(double x, double y): x(x), y(y) {}
-    Vec2D(): x(0), y(0) {}
-    Vec2D operator+(const Vec2D &v) const {
-        return Vec2D(x+v.x, y+v.y);
+// every type is a template on its scalar type, so the same code works in double where precision matters and in float
+// where it's enough, which fits twice as many values in a simd register. the names without a template argument
+// (Vec3D, Matrix4x4, ...) are the double versions and the ones ending in F are the float versions. everything except
+// length() and toString() is constexpr
+
+template <typename T>
+struct Vec2 {
+    T x,y;
+    constexpr Vec2(T x, T y): x(x), y(y) {}
+    constexpr Vec2(): x(0), y(0) {}
+    // converting between precisions has to be asked for
+    template <typename U>
+    constexpr explicit Vec2(const Vec2<U> &v): x(static_cast<T>(v.x)), y(static_cast<T>(v.y)) {}
+    constexpr Vec2 operator+(const Vec2 &v) const {
+        return Vec2(x+v.x, y+v.y);
     }
-    Vec2D operator-(const Vec2D &v) const {
-        return Vec2D(x-v.x, y-v.y);
+    constexpr Vec2 operator-(const Vec2 &v) const {
+        return Vec2(x-v.x, y-v.y);
     }
-    Vec2D operator*(const double &s) const {
-        return Vec2D(x*s, y*s);
+    constexpr Vec2 operator*(T s) const {
+        return Vec2(x*s, y*s);
     }
     // cross product of 2d vectors is essentially just the determinant of the matrix with them as column vectors
-    double cross(const Vec2D &v) const {
+    constexpr T cross(const Vec2 &v) const {
         return x * v.y - y * v.x;
     }
 };
 
-struct Vec3D {
-    double x,y,z;
-    Vec3D(double x, double y, double z): x(x), y(y), z(z) {}
-    Vec3D(): x(0), y(0), z(0) {}
+template <typename T>
+struct Vec3 {
+    T x,y,z;
+    constexpr Vec3(T x, T y, T z): x(x), y(y), z(z) {}
+    constexpr Vec3(): x(0), y(0), z(0) {}
+    template <typename U>
+    constexpr explicit Vec3(const Vec3<U> &v): x(static_cast<T>(v.x)), y(static_cast<T>(v.y)), z(static_cast<T>(v.z)) {}
     // define operators for addition, subtraction, and scalar multiplication
-    Vec3D operator+(const Vec3D &v) const {
-        return Vec3D(x+v.x, y+v.y, z+v.z);
+    constexpr Vec3 operator+(const Vec3 &v) const {
+        return Vec3(x+v.x, y+v.y, z+v.z);
     }
-    Vec3D operator-(const Vec3D &v) const {
-        return Vec3D(x-v.x, y-v.y, z-v.z);
+    constexpr Vec3 operator-(const Vec3 &v) const {
+        return Vec3(x-v.x, y-v.y, z-v.z);
     }
-    Vec3D operator*(const double &s) const {
-        return Vec3D(x*s, y*s, z*s);
+    constexpr Vec3 operator*(T s) const {
+        return Vec3(x*s, y*s, z*s);
     }
-    Vec3D cross(const Vec3D &v) const {
-        return Vec3D(
+    constexpr Vec3 cross(const Vec3 &v) const {
+        return Vec3(
             y * v.z - z * v.y,
             z * v.x - x * v.z,
             x * v.y - y * v.x
         );
     }
-    double dot(const Vec3D &v) const {
+    constexpr T dot(const Vec3 &v) const {
         return x * v.x + y * v.y + z * v.z;
     }
 
-    double length() const {
-        return sqrt(x*x + y*y + z*z);
+    T length() const {
+        return std::sqrt(x*x + y*y + z*z);
     }
 
-    // small margin for numerical error (not sure if this is necessary, but it is highly unlikely to cause problems)
-    bool operator==(const Vec3D& v) const {
-        return std::abs(x - v.x) < 0.00001 && std::abs(y - v.y) < 0.00001 && std::abs(z - v.z) < 0.00001;
+    // small margin for numerical error (not sure if this is necessary, but it is highly unlikely to cause problems).
+    // std::abs isn't constexpr until c++23, hence the comparisons
+    constexpr bool operator==(const Vec3& v) const {
+        auto close = [](T a, T b) {
+            T difference = a - b;
+            return (difference < 0 ? -difference : difference) < static_cast<T>(0.00001);
+        };
+        return close(x, v.x) && close(y, v.y) && close(z, v.z);
     }
 
-    bool operator!=(const Vec3D& v) const {
+    constexpr bool operator!=(const Vec3& v) const {
         return !(*this == v);
     }
 
-    bool operator<(const Vec3D& other) const {
+    constexpr bool operator<(const Vec3& other) const {
         if (x != other.x) return x < other.x;
         if (y != other.y) return y < other.y;
         return z < other.z;
@@ -84,21 +103,27 @@ struct Vec3D {
 
 };
 
-struct Vec4D {
-    double x,y,z,w;
-    Vec4D(double x, double y, double z, double w): x(x), y(y), z(z), w(w) {}
-    Vec4D(): x(0), y(0), z(0), w(0) {}
+// aligned to its own size (16 bytes for float, 32 for double), so a whole vector or matrix column is one aligned simd
+// load and never straddles two cache lines
+template <typename T>
+struct alignas(4 * sizeof(T)) Vec4 {
+    T x,y,z,w;
+    constexpr Vec4(T x, T y, T z, T w): x(x), y(y), z(z), w(w) {}
+    constexpr Vec4(): x(0), y(0), z(0), w(0) {}
+    template <typename U>
+    constexpr explicit Vec4(const Vec4<U> &v)
+        : x(static_cast<T>(v.x)), y(static_cast<T>(v.y)), z(static_cast<T>(v.z)), w(static_cast<T>(v.w)) {}
     // define operators for addition, subtraction, and scalar multiplication
-    Vec4D operator+(const Vec4D &v) const {
-        return Vec4D(x+v.x, y+v.y, z+v.z, w+v.w);
+    constexpr Vec4 operator+(const Vec4 &v) const {
+        return Vec4(x+v.x, y+v.y, z+v.z, w+v.w);
     }
-    Vec4D operator-(const Vec4D &v) const {
-        return Vec4D(x-v.x, y-v.y, z-v.z,w-v.w);
+    constexpr Vec4 operator-(const Vec4 &v) const {
+        return Vec4(x-v.x, y-v.y, z-v.z,w-v.w);
     }
-    Vec4D operator*(const double &s) const {
-        return Vec4D(x*s, y*s, z*s, w*s);
+    constexpr Vec4 operator*(T s) const {
+        return Vec4(x*s, y*s, z*s, w*s);
     }
-    double dot(const Vec4D &v) const {
+    constexpr T dot(const Vec4 &v) const {
         return x*v.x + y*v.y + z*v.z + w*v.w ;
     }
 };
@@ -110,37 +135,41 @@ struct Vec4D {
 ////
 //
 
-struct Matrix2x2 {
-    Vec2D c1,c2;
-    Matrix2x2(Vec2D c1, Vec2D c2): c1(c1), c2(c2){}
-    Matrix2x2(): c1(0,0), c2(0,0) {}
-    double det() const {
+template <typename T>
+struct Mat2 {
+    Vec2<T> c1,c2;
+    constexpr Mat2(Vec2<T> c1, Vec2<T> c2): c1(c1), c2(c2){}
+    constexpr Mat2(): c1(0,0), c2(0,0) {}
+    constexpr T det() const {
         return c1.x*c2.y-c1.y*c2.x;
     }
 };
 
-struct Matrix3x3 {
+template <typename T>
+struct Mat3 {
     // column vector for the matrix
-    Vec3D c1,c2,c3;
-    Matrix3x3(Vec3D c1, Vec3D c2, Vec3D c3): c1(c1), c2(c2), c3(c3) {}
-    Matrix3x3(): c1(0,0,0), c2(0,0,0), c3(0,0,0) {}
+    Vec3<T> c1,c2,c3;
+    constexpr Mat3(Vec3<T> c1, Vec3<T> c2, Vec3<T> c3): c1(c1), c2(c2), c3(c3) {}
+    constexpr Mat3(): c1(0,0,0), c2(0,0,0), c3(0,0,0) {}
+    template <typename U>
+    constexpr explicit Mat3(const Mat3<U> &m): c1(m.c1), c2(m.c2), c3(m.c3) {}
     // define operators for addition, subtraction, and scalar multiplication
-    Matrix3x3 operator+(const Matrix3x3 &m) const {
-        return Matrix3x3(c1+m.c1, c2+m.c2, c3+m.c3);
+    constexpr Mat3 operator+(const Mat3 &m) const {
+        return Mat3(c1+m.c1, c2+m.c2, c3+m.c3);
     }
-    Matrix3x3 operator-(const Matrix3x3 &m) const {
-        return Matrix3x3(c1-m.c1, c2-m.c2, c3-m.c3);
+    constexpr Mat3 operator-(const Mat3 &m) const {
+        return Mat3(c1-m.c1, c2-m.c2, c3-m.c3);
     }
-    Matrix3x3 operator*(const double &s) const {
-        return Matrix3x3(c1*s, c2*s, c3*s);
+    constexpr Mat3 operator*(T s) const {
+        return Mat3(c1*s, c2*s, c3*s);
     }
     // matrix-vector multiplication
-    Vec3D operator*(const Vec3D &v) const {
-        return Vec3D(c1.x * v.x + c2.x * v.y + c3.x * v.z, c1.y * v.x + c2.y * v.y + c3.y * v.z,c1.z * v.x + c2.z * v.y + c3.z * v.z);
+    constexpr Vec3<T> operator*(const Vec3<T> &v) const {
+        return Vec3<T>(c1.x * v.x + c2.x * v.y + c3.x * v.z, c1.y * v.x + c2.y * v.y + c3.y * v.z,c1.z * v.x + c2.z * v.y + c3.z * v.z);
     }
     // matrix composition
-    Matrix3x3 operator*(const Matrix3x3 &m) const {
-        return Matrix3x3(
+    constexpr Mat3 operator*(const Mat3 &m) const {
+        return Mat3(
             *this * m.c1,
             *this * m.c2,
             *this * m.c3
@@ -148,23 +177,26 @@ struct Matrix3x3 {
     }
 };
 
-struct Matrix4x4 {
-    Vec4D c1,c2,c3,c4;
-    Matrix4x4(Vec4D c1, Vec4D c2, Vec4D c3, Vec4D c4): c1(c1), c2(c2), c3(c3), c4(c4) {}
-    Matrix4x4(): c1(0,0,0,0), c2(0,0,0,0), c3(0,0,0,0), c4(0,0,0,0) {}
+template <typename T>
+struct Mat4 {
+    Vec4<T> c1,c2,c3,c4;
+    constexpr Mat4(const Vec4<T> &c1, const Vec4<T> &c2, const Vec4<T> &c3, const Vec4<T> &c4): c1(c1), c2(c2), c3(c3), c4(c4) {}
+    constexpr Mat4(): c1(0,0,0,0), c2(0,0,0,0), c3(0,0,0,0), c4(0,0,0,0) {}
+    template <typename U>
+    constexpr explicit Mat4(const Mat4<U> &m): c1(m.c1), c2(m.c2), c3(m.c3), c4(m.c4) {}
     // define operators for addition, subtraction, and scalar multiplication
-    Matrix4x4 operator+(const Matrix4x4 &m) const {
-        return Matrix4x4(c1+m.c1, c2+m.c2, c3+m.c3, c4+m.c4);
+    constexpr Mat4 operator+(const Mat4 &m) const {
+        return Mat4(c1+m.c1, c2+m.c2, c3+m.c3, c4+m.c4);
     }
-    Matrix4x4 operator-(const Matrix4x4 &m) const {
-        return Matrix4x4(c1-m.c1, c2-m.c2, c3-m.c3, c4-m.c4);
+    constexpr Mat4 operator-(const Mat4 &m) const {
+        return Mat4(c1-m.c1, c2-m.c2, c3-m.c3, c4-m.c4);
     }
-    Matrix4x4 operator*(const double &s) const {
-        return Matrix4x4(c1*s, c2*s, c3*s, c4*s);
+    constexpr Mat4 operator*(T s) const {
+        return Mat4(c1*s, c2*s, c3*s, c4*s);
     }
     // matrix-vector multiplication
-    Vec4D operator*(const Vec4D &v) const {
-        return Vec4D(
+    constexpr Vec4<T> operator*(const Vec4<T> &v) const {
+        return Vec4<T>(
             c1.x * v.x + c2.x * v.y + c3.x * v.z + c4.x * v.w,
             c1.y * v.x + c2.y * v.y + c3.y * v.z + c4.y * v.w,
             c1.z * v.x + c2.z * v.y + c3.z * v.z + c4.z * v.w,
@@ -173,8 +205,8 @@ struct Matrix4x4 {
     }
 
     // matrix composition
-    Matrix4x4 operator*(const Matrix4x4 &m) const {
-        return Matrix4x4(
+    constexpr Mat4 operator*(const Mat4 &m) const {
+        return Mat4(
             *this * m.c1,
             *this * m.c2,
             *this * m.c3,
@@ -184,13 +216,14 @@ struct Matrix4x4 {
 
 };
 
-// putting this after matrices because it is dependent on the Matrix4x4 struct
-struct Vec4DTranspose {
-    double x,y,z,w;
-    Vec4DTranspose(double x, double y, double z, double w): x(x), y(y), z(z), w(w) {}
-    Vec4DTranspose(Vec4D v): x(v.x), y(v.y), z(v.z), w(v.w) {}
-    Vec4DTranspose operator *(const Matrix4x4 &mat) {
-        return Vec4DTranspose(
+// putting this after matrices because it is dependent on the Mat4 struct
+template <typename T>
+struct alignas(4 * sizeof(T)) Vec4Transpose {
+    T x,y,z,w;
+    constexpr Vec4Transpose(T x, T y, T z, T w): x(x), y(y), z(z), w(w) {}
+    constexpr Vec4Transpose(const Vec4<T> &v): x(v.x), y(v.y), z(v.z), w(v.w) {}
+    constexpr Vec4Transpose operator *(const Mat4<T> &mat) const {
+        return Vec4Transpose(
             mat.c1.x*x + mat.c1.y*y + mat.c1.z*z + mat.c1.w*w,
              mat.c2.x*x + mat.c2.y*y + mat.c2.z*z + mat.c2.w*w,
              mat.c3.x*x + mat.c3.y*y + mat.c3.z*z + mat.c3.w*w,
@@ -198,6 +231,22 @@ struct Vec4DTranspose {
     }
 };
 
+using Vec2D = Vec2<double>;
+using Vec3D = Vec3<double>;
+using Vec4D = Vec4<double>;
+using Matrix2x2 = Mat2<double>;
+using Matrix3x3 = Mat3<double>;
+using Matrix4x4 = Mat4<double>;
+using Vec4DTranspose = Vec4Transpose<double>;
+
+using Vec2F = Vec2<float>;
+using Vec3F = Vec3<float>;
+using Vec4F = Vec4<float>;
+using Matrix2x2F = Mat2<float>;
+using Matrix3x3F = Mat3<float>;
+using Matrix4x4F = Mat4<float>;
+using Vec4FTranspose = Vec4Transpose<float>;
+
 
 //
 ////
@@ -205,7 +254,94 @@ struct Vec4DTranspose {
 ////
 //
 
-Vec2D getProjectedVector(const Vec3D &v, const sf::Image &image, const Vec3D &cameraPos, double camAngleX, double camAngleY);
+// everything about the camera that projection needs, built once per frame. the camera translation and rotation,
+// the y flip and the perspective projection are folded into a single matrix, so projecting a vertex is one
+// matrix-vector multiply plus the divide by w
+struct ViewState {
+    Vec3D cameraPos;
+    double camAngleX = 0, camAngleY = 0;
+    int width = 0, height = 0;
+    // world space to clip space
+    Matrix4x4 viewProjection;
+    // maps normalized device coordinates to pixels
+    double halfWidth = 0, halfHeight = 0;
+
+    ViewState() = default;
+    ViewState(const Vec3D &cameraPos, double camAngleX, double camAngleY, int width, int height);
+
+    // x and y are screen coordinates, z is 1/depth of the point for depth testing
+    Vec3D project(const Vec3D &v) const {
+        return project(viewProjection, v);
+    }
+
+    // project() for points in any space toClip maps to clip space, in double or float. the float version is what the
+    // float projectPoints() kernels do
+    template <typename T>
+    Vec3<T> project(const Mat4<T> &toClip, const Vec3<T> &v) const {
+        Vec4<T> transformed = toClip * Vec4<T>(v.x, v.y, v.z, 1);
+
+        // ensure no division by zero
+        const T minW = static_cast<T>(0.0001);
+        if (std::abs(transformed.w) < minW) {
+            transformed.w = minW;
+        }
+        T invW = 1 / transformed.w;
+
+        // normalized device coordinates to screen space
+        T screenX = (transformed.x * invW + 1) * static_cast<T>(halfWidth);
+        T screenY = (1 - transformed.y * invW) * static_cast<T>(halfHeight);
+        // clamp to the far side of the last pixel rather than onto it. an edge pinned to the right or bottom border
+        // would otherwise land exactly on the last column/row, which the rasterizer's fill rule leaves undrawn
+        screenX = std::max(static_cast<T>(0), std::min(screenX, static_cast<T>(width)));
+        screenY = std::max(static_cast<T>(0), std::min(screenY, static_cast<T>(height)));
+
+        // w is minus the distance along the view direction. 1/distance changes linearly across the screen, so it's what
+        // gets interpolated for the depth test (larger is closer)
+        return {screenX, screenY, -invW};
+    }
+};
+
+Vec2D getProjectedVector(const Vec3D &v, const ViewState &view);
+
+// same as getProjectedVector, but z holds 1/depth of the point for depth testing
+Vec3D getProjectedPoint(const Vec3D &v, const ViewState &view);
+
+
+//
+////
+// BATCH PROJECTION
+////
+//
+
+// points stored as separate x, y and z arrays (structure of arrays), so a simd register can be filled with the same
+// coordinate of several points in one load
+struct VertexStreams {
+    std::vector<double> x, y, z;
+    size_t size() const {
+        return x.size();
+    }
+    void resize(size_t n) {
+        x.resize(n);
+        y.resize(n);
+        z.resize(n);
+    }
+};
+
+// projects count points at once with the widest simd instructions the cpu supports: each group of points is
+// transformed into clip space and then divided by w and mapped into screen space. the results are exactly the
+// same as calling view.project() on every point. screenZ gets 1/depth like getProjectedPoint()
+void projectPoints(const ViewState &view, const double *x, const double *y, const double *z, size_t count,
+                   double *screenX, double *screenY, double *screenZ);
+
+// the float pipeline: the same projection with float math, which fits twice as many points in a register, for points
+// stored as floats. toClip maps the points' own space to clip space (view.viewProjection times whatever turns them
+// into world space), so nothing has to be converted to world space first. the results are the same as
+// view.project(toClip, point) in float, widened to double so they go into the same streams as the double pipeline's
+void projectPoints(const ViewState &view, const Matrix4x4F &toClip, const float *x, const float *y, const float *z,
+                   size_t count, double *screenX, double *screenY, double *screenZ);
+
+// name of the instruction set both projectPoints() use ("scalar", "sse2", "avx2" or "avx512")
+const char *getProjectionKernelName();
 
 
 #endif
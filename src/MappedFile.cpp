@@ -0,0 +1,79 @@
+//
+// Created by Cooper Stevens on 3/4/25.
+//
+
+#include "MappedFile.h"
+
+#include <fstream>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAPPEDFILE_POSIX 1
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+        close();
+        mapped = std::exchange(other.mapped, nullptr);
+        length = std::exchange(other.length, 0);
+        buffer = std::move(other.buffer);
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string &filename) {
+    close();
+#ifdef MAPPEDFILE_POSIX
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        return false;
+    }
+    // mmap can't map an empty file, but there's nothing to read anyway
+    if (info.st_size > 0) {
+        void *address = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address != MAP_FAILED) {
+            mapped = static_cast<const char *>(address);
+            length = static_cast<size_t>(info.st_size);
+            // the whole file is about to be read, so let the kernel start reading ahead
+            madvise(address, length, MADV_WILLNEED);
+        }
+    }
+    ::close(fd);
+    if (mapped || info.st_size == 0) return true;
+#endif
+    std::ifstream infile(filename, std::ios::binary | std::ios::ate);
+    if (!infile.is_open()) return false;
+    std::streamsize size = infile.tellg();
+    infile.seekg(0);
+    buffer.resize(static_cast<size_t>(size));
+    if (!infile.read(buffer.data(), size)) {
+        buffer.clear();
+        return false;
+    }
+    length = buffer.size();
+    return true;
+}
+
+void MappedFile::close() {
+#ifdef MAPPEDFILE_POSIX
+    if (mapped) munmap(const_cast<char *>(mapped), length);
+#endif
+    mapped = nullptr;
+    length = 0;
+    buffer.clear();
+}
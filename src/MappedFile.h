@@ -0,0 +1,41 @@
+//
+// Created by Cooper Stevens on 3/4/25.
+//
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// a read only view of a whole file. on posix systems the file is memory mapped, so nothing is copied and pages are
+// only read from disk when they're touched. elsewhere the file is read into memory instead
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    // returns false if the file can't be opened
+    bool open(const std::string &filename);
+    void close();
+
+    const char *data() const {
+        return mapped ? mapped : buffer.data();
+    }
+    size_t size() const {
+        return length;
+    }
+
+private:
+    const char *mapped = nullptr;
+    size_t length = 0;
+    // file contents when it isn't mapped
+    std::vector<char> buffer;
+};
+
+#endif
@@ -0,0 +1,485 @@
+//
+// Created by Cooper Stevens on 2/23/25.
+//
+
+#include "Mesh.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "CpuFeatures.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MESH_X86 1
+#endif
+
+// Vec3D::operator== treats coordinates closer than this as equal
+constexpr double WELD_EPSILON = 0.00001;
+// spatial hash cell size. cells are a bit bigger than the margin so a lookup usually only has to check the vertex's
+// own cell, and only checks a neighbor when the vertex is within the margin of a cell border
+constexpr double WELD_CELL_SIZE = 10 * WELD_EPSILON;
+
+Mesh::Mesh(std::vector<Triangle3D> const &surfaceTriangles) {
+    MeshBuilder builder;
+    for (const auto &tri : surfaceTriangles) builder.addTriangle(tri.a, tri.b, tri.c);
+    *this = builder.build();
+}
+
+Mesh::Mesh(MeshData data) {
+    auto owned = std::make_shared<MeshData>(std::move(data));
+    pointAt(*owned);
+    ownData = owned.get();
+    storage = std::move(owned);
+    computeBounds();
+}
+
+Mesh::Mesh(std::span<const double> x, std::span<const double> y, std::span<const double> z,
+           std::span<const uint32_t> indices, std::span<const Vec3D> normals, const Vec3D &boundsMin,
+           const Vec3D &boundsMax, std::shared_ptr<const void> storage)
+    : x(x), y(y), z(z), indices(indices), normals(normals), boundsMin(boundsMin), boundsMax(boundsMax),
+      storage(std::move(storage)) {}
+
+// the arrays of a compact mesh (see compactMesh()). only the ones for its format are filled
+struct CompactMeshData {
+    std::vector<float> floatX, floatY, floatZ;
+    std::vector<uint16_t> quantizedX, quantizedY, quantizedZ;
+    std::vector<uint32_t> indices;
+    std::vector<uint32_t> packedNormals;
+};
+
+void Mesh::pointAt(const MeshData &data) {
+    format = MeshFormat::Double;
+    floatX = floatY = floatZ = {};
+    quantizedX = quantizedY = quantizedZ = {};
+    packedNormals = {};
+    x = data.vertices.x;
+    y = data.vertices.y;
+    z = data.vertices.z;
+    indices = data.indices;
+    normals = data.normals;
+}
+
+MeshData &Mesh::getWritableData() {
+    if (!ownData || storage.use_count() != 1) {
+        auto copy = std::make_shared<MeshData>();
+        copy->vertices.resize(getVertexCount());
+        decodeVertices(0, getVertexCount(), copy->vertices.x.data(), copy->vertices.y.data(), copy->vertices.z.data());
+        copy->indices.assign(indices.begin(), indices.end());
+        copy->normals.resize(getTriangleCount());
+        for (size_t i = 0; i < getTriangleCount(); i++) copy->normals[i] = getNormal(i);
+        pointAt(*copy);
+        ownData = copy.get();
+        storage = std::move(copy);
+    }
+    return *ownData;
+}
+
+// the decode kernels. like projectPoints() there's a plain version and a wider one picked at startup, and both give
+// exactly the same results as getVertex() and decodeOctahedral(), just several values at a time
+template <typename T>
+static void decodeStreamScalar(const T *stored, size_t count, double offset, double scale, double *out) {
+    for (size_t i = 0; i < count; i++) out[i] = offset + scale * stored[i];
+}
+
+static void widenQuantizedScalar(const uint16_t *stored, size_t count, float *out) {
+    for (size_t i = 0; i < count; i++) out[i] = stored[i];
+}
+
+static void decodeNormalsScalar(const uint32_t *codes, size_t count, double *outX, double *outY, double *outZ) {
+    for (size_t i = 0; i < count; i++) {
+        Vec3D normal = decodeOctahedral(codes[i]);
+        outX[i] = normal.x;
+        outY[i] = normal.y;
+        outZ[i] = normal.z;
+    }
+}
+
+#ifdef MESH_X86
+
+__attribute__((target("avx2")))
+static void decodeQuantizedAVX2(const uint16_t *stored, size_t count, double offset, double scale, double *out) {
+    const __m256d offsets = _mm256_set1_pd(offset), scales = _mm256_set1_pd(scale);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i values = _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(stored + i)));
+        _mm256_storeu_pd(out + i, _mm256_add_pd(offsets, _mm256_mul_pd(scales, _mm256_cvtepi32_pd(values))));
+    }
+    decodeStreamScalar(stored + i, count - i, offset, scale, out + i);
+}
+
+__attribute__((target("avx2")))
+static void widenQuantizedAVX2(const uint16_t *stored, size_t count, float *out) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i values = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(stored + i)));
+        _mm256_storeu_ps(out + i, _mm256_cvtepi32_ps(values));
+    }
+    widenQuantizedScalar(stored + i, count - i, out + i);
+}
+
+__attribute__((target("avx2")))
+static void decodeFloatAVX2(const float *stored, size_t count, double offset, double scale, double *out) {
+    const __m256d offsets = _mm256_set1_pd(offset), scales = _mm256_set1_pd(scale);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d values = _mm256_cvtps_pd(_mm_loadu_ps(stored + i));
+        _mm256_storeu_pd(out + i, _mm256_add_pd(offsets, _mm256_mul_pd(scales, values)));
+    }
+    decodeStreamScalar(stored + i, count - i, offset, scale, out + i);
+}
+
+__attribute__((target("avx2")))
+static void decodeNormalsAVX2(const uint32_t *codes, size_t count, double *outX, double *outY, double *outZ) {
+    const __m256d signBit = _mm256_set1_pd(-0.0);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d step = _mm256_set1_pd(1.0 / 32767.0);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m128i zeroNormal = _mm_set1_epi32(static_cast<int>(0x80008000u));
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i *>(codes + i));
+        // sign extend each half
+        __m256d x = _mm256_mul_pd(_mm256_cvtepi32_pd(_mm_srai_epi32(_mm_slli_epi32(packed, 16), 16)), step);
+        __m256d y = _mm256_mul_pd(_mm256_cvtepi32_pd(_mm_srai_epi32(packed, 16)), step);
+        __m256d z = _mm256_sub_pd(_mm256_sub_pd(one, _mm256_andnot_pd(signBit, x)), _mm256_andnot_pd(signBit, y));
+        // unfold the lower half
+        __m256d t = _mm256_max_pd(_mm256_xor_pd(z, signBit), zero);
+        x = _mm256_sub_pd(x, _mm256_or_pd(t, _mm256_and_pd(x, signBit)));
+        y = _mm256_sub_pd(y, _mm256_or_pd(t, _mm256_and_pd(y, signBit)));
+        __m256d length = _mm256_sqrt_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(x, x), _mm256_mul_pd(y, y)), _mm256_mul_pd(z, z)));
+        __m256d scale = _mm256_div_pd(one, length);
+        __m256d isZero = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm_cmpeq_epi32(packed, zeroNormal)));
+        _mm256_storeu_pd(outX + i, _mm256_andnot_pd(isZero, _mm256_mul_pd(x, scale)));
+        _mm256_storeu_pd(outY + i, _mm256_andnot_pd(isZero, _mm256_mul_pd(y, scale)));
+        _mm256_storeu_pd(outZ + i, _mm256_andnot_pd(isZero, _mm256_mul_pd(z, scale)));
+    }
+    decodeNormalsScalar(codes + i, count - i, outX + i, outY + i, outZ + i);
+}
+
+#endif
+
+struct DecodeKernels {
+    void (*quantized)(const uint16_t *, size_t, double, double, double *);
+    void (*floats)(const float *, size_t, double, double, double *);
+    void (*normals)(const uint32_t *, size_t, double *, double *, double *);
+    void (*widenQuantized)(const uint16_t *, size_t, float *);
+};
+
+static DecodeKernels pickDecodeKernels() {
+#ifdef MESH_X86
+    if (getCpuFeatures().avx2) return {decodeQuantizedAVX2, decodeFloatAVX2, decodeNormalsAVX2, widenQuantizedAVX2};
+#endif
+    return {decodeStreamScalar<uint16_t>, decodeStreamScalar<float>, decodeNormalsScalar, widenQuantizedScalar};
+}
+
+static DecodeKernels decodeKernels = pickDecodeKernels();
+
+void Mesh::widenQuantizedVertices(size_t first, size_t count, float *outX, float *outY, float *outZ) const {
+    decodeKernels.widenQuantized(quantizedX.data() + first, count, outX);
+    decodeKernels.widenQuantized(quantizedY.data() + first, count, outY);
+    decodeKernels.widenQuantized(quantizedZ.data() + first, count, outZ);
+}
+
+void Mesh::decodeVertices(size_t first, size_t count, double *outX, double *outY, double *outZ) const {
+    switch (format) {
+        case MeshFormat::Float:
+            decodeKernels.floats(floatX.data() + first, count, decodeOffset.x, decodeScale.x, outX);
+            decodeKernels.floats(floatY.data() + first, count, decodeOffset.y, decodeScale.y, outY);
+            decodeKernels.floats(floatZ.data() + first, count, decodeOffset.z, decodeScale.z, outZ);
+            break;
+        case MeshFormat::Quantized16:
+            decodeKernels.quantized(quantizedX.data() + first, count, decodeOffset.x, decodeScale.x, outX);
+            decodeKernels.quantized(quantizedY.data() + first, count, decodeOffset.y, decodeScale.y, outY);
+            decodeKernels.quantized(quantizedZ.data() + first, count, decodeOffset.z, decodeScale.z, outZ);
+            break;
+        default:
+            std::copy_n(x.data() + first, count, outX);
+            std::copy_n(y.data() + first, count, outY);
+            std::copy_n(z.data() + first, count, outZ);
+            break;
+    }
+}
+
+void Mesh::decodeNormals(size_t first, size_t count, double *outX, double *outY, double *outZ) const {
+    if (format != MeshFormat::Double) {
+        decodeKernels.normals(packedNormals.data() + first, count, outX, outY, outZ);
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        outX[i] = normals[first + i].x;
+        outY[i] = normals[first + i].y;
+        outZ[i] = normals[first + i].z;
+    }
+}
+
+// decodeCorners() for one position format. the same sum as getVertex()
+template <typename T>
+static void decodeCornersOf(const uint32_t *corners, size_t count, const T *x, const T *y, const T *z,
+                            const Vec3D &offset, const Vec3D &scale, double *outX, double *outY, double *outZ) {
+    for (size_t i = 0; i < count; i++) {
+        uint32_t vertex = corners[i];
+        outX[i] = offset.x + scale.x * x[vertex];
+        outY[i] = offset.y + scale.y * y[vertex];
+        outZ[i] = offset.z + scale.z * z[vertex];
+    }
+}
+
+void Mesh::decodeCorners(size_t first, size_t count, double *outX, double *outY, double *outZ) const {
+    const uint32_t *corners = indices.data() + 3 * first;
+    switch (format) {
+        case MeshFormat::Float:
+            decodeCornersOf(corners, 3 * count, floatX.data(), floatY.data(), floatZ.data(), decodeOffset, decodeScale,
+                            outX, outY, outZ);
+            break;
+        case MeshFormat::Quantized16:
+            decodeCornersOf(corners, 3 * count, quantizedX.data(), quantizedY.data(), quantizedZ.data(), decodeOffset,
+                            decodeScale, outX, outY, outZ);
+            break;
+        default:
+            for (size_t i = 0; i < 3 * count; i++) {
+                outX[i] = x[corners[i]];
+                outY[i] = y[corners[i]];
+                outZ[i] = z[corners[i]];
+            }
+    }
+}
+
+size_t Mesh::getMemoryUsage() const {
+    return x.size_bytes() + y.size_bytes() + z.size_bytes() + floatX.size_bytes() + floatY.size_bytes() +
+           floatZ.size_bytes() + quantizedX.size_bytes() + quantizedY.size_bytes() + quantizedZ.size_bytes() +
+           indices.size_bytes() + normals.size_bytes() + packedNormals.size_bytes();
+}
+
+void Mesh::translate(const Vec3D &t) {
+    VertexStreams &vertices = getWritableData().vertices;
+    for (size_t i = 0; i < vertices.size(); i++) {
+        vertices.x[i] += t.x;
+        vertices.y[i] += t.y;
+        vertices.z[i] += t.z;
+    }
+    boundsMin = boundsMin + t;
+    boundsMax = boundsMax + t;
+}
+
+void Mesh::computeBounds() {
+    if (getVertexCount() == 0) return;
+    boundsMin = boundsMax = getVertex(0);
+    for (uint32_t i = 0; i < getVertexCount(); i++) {
+        Vec3D v = getVertex(i);
+        boundsMin = Vec3D(std::min(boundsMin.x, v.x), std::min(boundsMin.y, v.y), std::min(boundsMin.z, v.z));
+        boundsMax = Vec3D(std::max(boundsMax.x, v.x), std::max(boundsMax.y, v.y), std::max(boundsMax.z, v.z));
+    }
+}
+
+uint32_t encodeOctahedral(const Vec3D &normal) {
+    double sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    // a triangle with no area gets a NaN normal when it's loaded (its cross product is normalized by dividing by
+    // zero) and a zero one from ensureNormalsFaceOutward(). clamping and converting NaN to an integer isn't defined, so
+    // both get the zero code
+    if (!std::isfinite(sum) || sum == 0) return 0x80008000u;
+    double x = normal.x / sum;
+    double y = normal.y / sum;
+    // fold the lower half over the upper one
+    if (normal.z < 0) {
+        double foldedX = (1.0 - std::abs(y)) * (x >= 0 ? 1.0 : -1.0);
+        y = (1.0 - std::abs(x)) * (y >= 0 ? 1.0 : -1.0);
+        x = foldedX;
+    }
+    // rounding x and y each to the nearest step isn't always the closest direction, so the four codes around the
+    // exact point are tried and the one that decodes closest to the normal is kept
+    Vec3D unit = normal * (1.0 / normal.length());
+    uint32_t best = 0;
+    double bestDot = -2;
+    for (int i = 0; i < 4; i++) {
+        double codeX = (i & 1 ? std::ceil(x * 32767.0) : std::floor(x * 32767.0));
+        double codeY = (i & 2 ? std::ceil(y * 32767.0) : std::floor(y * 32767.0));
+        auto packedX = static_cast<uint16_t>(static_cast<int16_t>(std::clamp(codeX, -32767.0, 32767.0)));
+        auto packedY = static_cast<uint16_t>(static_cast<int16_t>(std::clamp(codeY, -32767.0, 32767.0)));
+        uint32_t code = packedX | static_cast<uint32_t>(packedY) << 16;
+        double dot = decodeOctahedral(code).dot(unit);
+        if (dot > bestDot) {
+            best = code;
+            bestDot = dot;
+        }
+    }
+    return best;
+}
+
+Mesh compactMesh(const Mesh &mesh, MeshFormat format) {
+    if (format == mesh.format) return mesh;
+    if (format == MeshFormat::Double) {
+        Mesh expanded = mesh;
+        expanded.getWritableData();
+        return expanded;
+    }
+
+    auto data = std::make_shared<CompactMeshData>();
+    Mesh compact;
+    compact.format = format;
+    compact.center = mesh.center;
+    compact.boundsMin = mesh.boundsMin;
+    compact.boundsMax = mesh.boundsMax;
+    size_t vertexCount = mesh.getVertexCount();
+    Vec3D extent = mesh.boundsMax - mesh.boundsMin;
+    if (format == MeshFormat::Float) {
+        // relative to the middle of the bounds, so the floats' precision goes to the mesh's size rather than to how far
+        // it is from the origin
+        compact.decodeOffset = (mesh.boundsMin + mesh.boundsMax) * 0.5;
+        compact.decodeScale = Vec3D(1, 1, 1);
+        data->floatX.resize(vertexCount);
+        data->floatY.resize(vertexCount);
+        data->floatZ.resize(vertexCount);
+        for (uint32_t i = 0; i < vertexCount; i++) {
+            Vec3D v = mesh.getVertex(i) - compact.decodeOffset;
+            data->floatX[i] = static_cast<float>(v.x);
+            data->floatY[i] = static_cast<float>(v.y);
+            data->floatZ[i] = static_cast<float>(v.z);
+        }
+    } else {
+        // 65535 steps across the bounds on each axis. a flat axis has only one value
+        compact.decodeOffset = mesh.boundsMin;
+        compact.decodeScale = extent * (1.0 / 65535.0);
+        auto quantize = [](double value, double min, double step) {
+            return static_cast<uint16_t>(step > 0 ? std::clamp(std::round((value - min) / step), 0.0, 65535.0) : 0);
+        };
+        data->quantizedX.resize(vertexCount);
+        data->quantizedY.resize(vertexCount);
+        data->quantizedZ.resize(vertexCount);
+        for (uint32_t i = 0; i < vertexCount; i++) {
+            Vec3D v = mesh.getVertex(i);
+            data->quantizedX[i] = quantize(v.x, compact.decodeOffset.x, compact.decodeScale.x);
+            data->quantizedY[i] = quantize(v.y, compact.decodeOffset.y, compact.decodeScale.y);
+            data->quantizedZ[i] = quantize(v.z, compact.decodeOffset.z, compact.decodeScale.z);
+        }
+    }
+    data->indices.assign(mesh.indices.begin(), mesh.indices.end());
+    data->packedNormals.resize(mesh.getTriangleCount());
+    for (size_t i = 0; i < mesh.getTriangleCount(); i++) data->packedNormals[i] = encodeOctahedral(mesh.getNormal(i));
+
+    compact.floatX = data->floatX;
+    compact.floatY = data->floatY;
+    compact.floatZ = data->floatZ;
+    compact.quantizedX = data->quantizedX;
+    compact.quantizedY = data->quantizedY;
+    compact.quantizedZ = data->quantizedZ;
+    compact.indices = data->indices;
+    compact.packedNormals = data->packedNormals;
+    compact.storage = std::move(data);
+    return compact;
+}
+
+const char *getMeshFormatName(MeshFormat format) {
+    switch (format) {
+        case MeshFormat::Float: return "float";
+        case MeshFormat::Quantized16: return "quantized16";
+        default: return "double";
+    }
+}
+
+void MeshBuilder::addTriangle(const Vec3D &a, const Vec3D &b, const Vec3D &c) {
+    // the normal comes from the corners as they were given, before welding moves them by up to the margin
+    Vec3D normal = (b-a).cross(c-a);
+    data.normals.push_back(normal * (1.0/normal.length()));
+    data.indices.push_back(addVertex(a));
+    data.indices.push_back(addVertex(b));
+    data.indices.push_back(addVertex(c));
+}
+
+uint32_t MeshBuilder::addVertex(const Vec3D &v) {
+    // look through every cell a position within the margin of v could be in
+    int64_t minX = static_cast<int64_t>(std::floor((v.x - WELD_EPSILON) / WELD_CELL_SIZE));
+    int64_t minY = static_cast<int64_t>(std::floor((v.y - WELD_EPSILON) / WELD_CELL_SIZE));
+    int64_t minZ = static_cast<int64_t>(std::floor((v.z - WELD_EPSILON) / WELD_CELL_SIZE));
+    int64_t maxX = static_cast<int64_t>(std::floor((v.x + WELD_EPSILON) / WELD_CELL_SIZE));
+    int64_t maxY = static_cast<int64_t>(std::floor((v.y + WELD_EPSILON) / WELD_CELL_SIZE));
+    int64_t maxZ = static_cast<int64_t>(std::floor((v.z + WELD_EPSILON) / WELD_CELL_SIZE));
+    for (int64_t x = minX; x <= maxX; x++) {
+        for (int64_t y = minY; y <= maxY; y++) {
+            for (int64_t z = minZ; z <= maxZ; z++) {
+                auto cell = cells.find({x, y, z});
+                if (cell == cells.end()) continue;
+                for (uint32_t i = cell->second; i != UINT32_MAX; i = nextInCell[i]) {
+                    if (Vec3D(data.vertices.x[i], data.vertices.y[i], data.vertices.z[i]) == v) return i;
+                }
+            }
+        }
+    }
+
+    // new vertex
+    uint32_t index = static_cast<uint32_t>(data.vertices.size());
+    data.vertices.x.push_back(v.x);
+    data.vertices.y.push_back(v.y);
+    data.vertices.z.push_back(v.z);
+    Cell home = {
+        static_cast<int64_t>(std::floor(v.x / WELD_CELL_SIZE)),
+        static_cast<int64_t>(std::floor(v.y / WELD_CELL_SIZE)),
+        static_cast<int64_t>(std::floor(v.z / WELD_CELL_SIZE))
+    };
+    auto [cell, inserted] = cells.try_emplace(home, index);
+    nextInCell.push_back(inserted ? UINT32_MAX : cell->second);
+    cell->second = index;
+    return index;
+}
+
+Mesh MeshBuilder::build() {
+    Mesh result(std::move(data));
+    data = MeshData();
+    cells.clear();
+    nextInCell.clear();
+    return result;
+}
+
+Vec3D computeMeshCenter(const Mesh& mesh) {
+    Vec3D weightedSum(0, 0, 0);
+    double totalArea = 0.0;
+
+    for (size_t i = 0; i < mesh.getTriangleCount(); i++) {
+        Vec3D a = mesh.getCorner(i, 0), b = mesh.getCorner(i, 1), c = mesh.getCorner(i, 2);
+        Vec3D edge1 = b - a;
+        Vec3D edge2 = c - a;
+        double area = edge1.cross(edge2).length() * 0.5;
+        Vec3D centroid = (a + b + c) * (1.0 / 3.0);
+
+        weightedSum = weightedSum + (centroid * area);
+        totalArea += area;
+    }
+
+    // avoid runtime error
+    if (totalArea == 0.0) return Vec3D(0, 0, 0);
+
+    // find the weighted average
+    Vec3D meshCenter = weightedSum * (1.0 / totalArea);
+    return meshCenter;
+}
+
+// this works for relatively simple meshes and is dependent on all vectors from mesh's centroid to the triangles' centroids facing outwards (if the mesh centroid is outside of the mesh, this will not work)
+// typically mesh triangles are defined in the .txt files in the /inputs directory in such a way that their normals are facing outwards.
+// (this occurs when the triangle vertices are defined in counterclockwise order when looking directly at the triangle from outside the mesh)
+// but some input files do not follow this pattern, so this function ensures a mesh's triangle normals are oriented properly
+void ensureNormalsFaceOutward(Mesh& mesh) {
+    Vec3D meshCenter = computeMeshCenter(mesh);
+    std::vector<Vec3D> &normals = mesh.getWritableData().normals;
+
+    for (size_t i = 0; i < mesh.getTriangleCount(); i++) {
+
+        Vec3D normal = mesh.getNormal(i);
+
+        // check for triangles wth 0 area (colinear vertices)
+        double area = normal.length() * 0.5;
+        if (area == 0.0) {
+            normals[i] = Vec3D(0, 0, 0);
+            continue;
+        }
+        Vec3D centroid = mesh.getCentroid(i);
+
+        // vec from mesh center to triangle centroid
+        Vec3D toCentroid = centroid - meshCenter;
+
+        // check if the normal is pointing inward or outward
+        double dotProduct = normal.dot(toCentroid);
+        if (dotProduct < 0) normal = normal * (-1.0);
+
+        normals[i] = normal;
+    }
+}
@@ -0,0 +1,209 @@
+//
+// Created by Cooper Stevens on 2/23/25.
+//
+
+#ifndef MESH_H
+#define MESH_H
+
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include "LinAlg.h"
+
+struct Triangle3D {
+    Vec3D a, b, c, normal;
+    Triangle3D(Vec3D a, Vec3D b, Vec3D c) : a(a), b(b), c(c) {
+        normal = (b-a).cross(c-a);
+        normal = normal * (1.0/normal.length());
+    }
+};
+
+// how a mesh stores its positions and normals (see compactMesh())
+enum class MeshFormat {
+    // doubles, exactly as loaded. 24 bytes per vertex and 24 per normal
+    Double,
+    // positions as floats relative to the center of the bounds, normals octahedral encoded. 12 bytes per vertex and
+    // 4 per normal
+    Float,
+    // positions as 16 bit fractions of the bounds on each axis, normals octahedral encoded. 6 bytes per vertex and
+    // 4 per normal
+    Quantized16
+};
+
+// packs a unit vector into two 16 bit signed numbers (x in the low half): the vector is projected onto the octahedron
+// |x| + |y| + |z| = 1 and the lower half of the octahedron is folded over the upper half, so the whole sphere maps onto
+// a square with about the same precision everywhere, 0.00005 radians at worst. the normal of a triangle with no area,
+// which is NaN as loaded or zero after ensureNormalsFaceOutward(), gets a code of its own that decodes to zero
+uint32_t encodeOctahedral(const Vec3D &normal);
+
+inline Vec3D decodeOctahedral(uint32_t code) {
+    if (code == 0x80008000u) return {0, 0, 0};
+    double x = static_cast<int16_t>(code & 0xFFFF) * (1.0 / 32767.0);
+    double y = static_cast<int16_t>(code >> 16) * (1.0 / 32767.0);
+    double z = 1.0 - std::abs(x) - std::abs(y);
+    // unfold the lower half. moving x and y towards the edge by -z does the same as mirroring them across it, without
+    // a branch
+    double t = std::max(-z, 0.0);
+    x -= std::copysign(t, x);
+    y -= std::copysign(t, y);
+    return Vec3D(x, y, z) * (1.0 / std::sqrt(x * x + y * y + z * z));
+}
+
+// the arrays of an indexed mesh, owned
+struct MeshData {
+    VertexStreams vertices;
+    std::vector<uint32_t> indices;
+    std::vector<Vec3D> normals;
+};
+
+// an indexed triangle mesh. every position is stored once and the triangles refer to it by index, so a vertex shared
+// by six triangles is only stored (and projected every frame) once.
+// the arrays are views, so a mesh can use a mapped .rmesh file without copying it. copies of a mesh share the arrays
+// and anything that changes them makes its own copy first.
+// the positions and normals are stored in one of the formats of MeshFormat, and only that format's arrays are set.
+// getVertex() and getNormal() work for all of them
+struct Mesh {
+    MeshFormat format = MeshFormat::Double;
+    // unique vertex positions, as x, y and z streams
+    std::span<const double> x, y, z;
+    // the compact formats' positions. position = decodeOffset + decodeScale * stored value, on each axis
+    std::span<const float> floatX, floatY, floatZ;
+    std::span<const uint16_t> quantizedX, quantizedY, quantizedZ;
+    Vec3D decodeOffset, decodeScale;
+    // three indices into the vertices per triangle
+    std::span<const uint32_t> indices;
+    // one normal per triangle
+    std::span<const Vec3D> normals;
+    // the compact formats' normals, one per triangle (see encodeOctahedral())
+    std::span<const uint32_t> packedNormals;
+    Vec3D center;
+    // axis aligned bounding box of all vertices
+    Vec3D boundsMin, boundsMax;
+
+    Mesh() = default;
+    explicit Mesh(std::vector<Triangle3D> const &surfaceTriangles);
+    explicit Mesh(MeshData data);
+    // uses arrays that live in memory kept alive by storage (like a mapped file) without copying or reading them,
+    // so the bounds have to be passed in
+    Mesh(std::span<const double> x, std::span<const double> y, std::span<const double> z,
+         std::span<const uint32_t> indices, std::span<const Vec3D> normals, const Vec3D &boundsMin,
+         const Vec3D &boundsMax, std::shared_ptr<const void> storage);
+
+    size_t getVertexCount() const {
+        switch (format) {
+            case MeshFormat::Float: return floatX.size();
+            case MeshFormat::Quantized16: return quantizedX.size();
+            default: return x.size();
+        }
+    }
+    size_t getTriangleCount() const {
+        return indices.size() / 3;
+    }
+    Vec3D getVertex(uint32_t i) const {
+        switch (format) {
+            case MeshFormat::Float:
+                return {decodeOffset.x + decodeScale.x * floatX[i], decodeOffset.y + decodeScale.y * floatY[i],
+                        decodeOffset.z + decodeScale.z * floatZ[i]};
+            case MeshFormat::Quantized16:
+                return {decodeOffset.x + decodeScale.x * quantizedX[i], decodeOffset.y + decodeScale.y * quantizedY[i],
+                        decodeOffset.z + decodeScale.z * quantizedZ[i]};
+            default: return {x[i], y[i], z[i]};
+        }
+    }
+    Vec3D getNormal(size_t triangle) const {
+        return format == MeshFormat::Double ? normals[triangle] : decodeOctahedral(packedNormals[triangle]);
+    }
+    // the matrix that turns the stored positions of a compact mesh into world space (decodeOffset and decodeScale), so
+    // the transform stage can fold it into the view projection and project the stored values directly
+    Matrix4x4 getDecodeTransform() const {
+        return {Vec4D(decodeScale.x, 0, 0, 0), Vec4D(0, decodeScale.y, 0, 0), Vec4D(0, 0, decodeScale.z, 0),
+                Vec4D(decodeOffset.x, decodeOffset.y, decodeOffset.z, 1)};
+    }
+    // decodes the positions of count vertices starting at first into three streams of doubles. uses simd instructions
+    // when the cpu has them
+    void decodeVertices(size_t first, size_t count, double *outX, double *outY, double *outZ) const;
+    // the stored values of a Quantized16 mesh as floats, which holds them exactly, for the float pipeline
+    void widenQuantizedVertices(size_t first, size_t count, float *outX, float *outY, float *outZ) const;
+    // the same for the normals of count triangles starting at first
+    void decodeNormals(size_t first, size_t count, double *outX, double *outY, double *outZ) const;
+    // the positions of the three corners of count triangles starting at first, corner by corner, into 3 * count
+    // entries of each stream. gives the same values as getVertex() without switching on the format for every corner
+    void decodeCorners(size_t first, size_t count, double *outX, double *outY, double *outZ) const;
+    // bytes taken by the mesh's arrays
+    size_t getMemoryUsage() const;
+    // corner (0, 1 or 2) of a triangle
+    Vec3D getCorner(size_t triangle, int corner) const {
+        return getVertex(indices[3 * triangle + corner]);
+    }
+    Vec3D getCentroid(size_t triangle) const {
+        return (getCorner(triangle, 0) + getCorner(triangle, 1) + getCorner(triangle, 2)) * (1.0 / 3.0);
+    }
+
+    void translate(const Vec3D &t);
+    void computeBounds();
+
+    // the mesh's arrays for changing them in place. they're copied first unless this mesh is their only owner, and a
+    // compact mesh is decoded back into doubles
+    MeshData &getWritableData();
+
+private:
+    friend Mesh compactMesh(const Mesh &mesh, MeshFormat format);
+    void pointAt(const MeshData &data);
+
+    // keeps the arrays alive
+    std::shared_ptr<const void> storage;
+    // set when storage is a MeshData (rather than a mapped file)
+    MeshData *ownData = nullptr;
+};
+
+// builds a Mesh one triangle at a time, welding corners into shared vertices. two positions are welded when they're
+// equal according to Vec3D::operator==, found through a spatial hash so loading stays linear in the vertex count
+class MeshBuilder {
+public:
+    void addTriangle(const Vec3D &a, const Vec3D &b, const Vec3D &c);
+    // number of corners added so far, i.e. the vertex count without welding
+    size_t getCornerCount() const {
+        return data.indices.size();
+    }
+    size_t getVertexCount() const {
+        return data.vertices.size();
+    }
+    // hands over the mesh and resets the builder
+    Mesh build();
+
+private:
+    struct Cell {
+        int64_t x, y, z;
+        bool operator==(const Cell &other) const {
+            return x == other.x && y == other.y && z == other.z;
+        }
+    };
+    struct CellHash {
+        size_t operator()(const Cell &cell) const {
+            return static_cast<size_t>(cell.x * 73856093 ^ cell.y * 19349663 ^ cell.z * 83492791);
+        }
+    };
+
+    uint32_t addVertex(const Vec3D &v);
+
+    MeshData data;
+    // the most recently added vertex in each cell, with the rest of the cell chained through nextInCell
+    std::unordered_map<Cell, uint32_t, CellHash> cells;
+    std::vector<uint32_t> nextInCell;
+};
+
+// a copy of mesh stored in a smaller format. Quantized16 positions are within 1/131070 of the bounds' size of the
+// originals on each axis and Float ones within float rounding, and shared vertices stay shared, so no cracks open up
+Mesh compactMesh(const Mesh &mesh, MeshFormat format);
+
+// "double", "float" or "quantized16"
+const char *getMeshFormatName(MeshFormat format);
+
+Vec3D computeMeshCenter(const Mesh& mesh);
+
+void ensureNormalsFaceOutward(Mesh& mesh);
+
+#endif
@@ -0,0 +1,183 @@
+//
+// Created by Cooper Stevens on 3/9/25.
+//
+
+#include "MeshCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <type_traits>
+
+#include "MappedFile.h"
+
+// bump whenever the layout or the way meshes are loaded changes, so old caches get rebuilt
+constexpr uint32_t RMESH_VERSION = 1;
+constexpr char RMESH_MAGIC[4] = {'R', 'M', 'S', 'H'};
+// reads back differently on a machine with the other byte order
+constexpr uint32_t RMESH_BYTE_ORDER = 0x01020304;
+constexpr uint64_t RMESH_ALIGNMENT = 64;
+
+struct RMeshHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t reserved;
+    uint64_t sourceSize;
+    int64_t sourceModified;
+    uint64_t sourceHash;
+    uint64_t vertexCount;
+    uint64_t triangleCount;
+    double boundsMin[3];
+    double boundsMax[3];
+    // byte offsets of the arrays from the start of the file
+    uint64_t xOffset, yOffset, zOffset, indexOffset, normalOffset;
+};
+
+// the normals are used straight out of the file as Vec3Ds
+static_assert(sizeof(Vec3D) == 3 * sizeof(double) && std::is_trivially_copyable_v<Vec3D>);
+
+static uint64_t alignOffset(uint64_t offset) {
+    return (offset + RMESH_ALIGNMENT - 1) / RMESH_ALIGNMENT * RMESH_ALIGNMENT;
+}
+
+// offsets of the arrays for a mesh of this size, and the total file size
+static uint64_t layoutArrays(RMeshHeader &header) {
+    uint64_t offset = alignOffset(sizeof(RMeshHeader));
+    header.xOffset = offset;
+    offset = alignOffset(offset + header.vertexCount * sizeof(double));
+    header.yOffset = offset;
+    offset = alignOffset(offset + header.vertexCount * sizeof(double));
+    header.zOffset = offset;
+    offset = alignOffset(offset + header.vertexCount * sizeof(double));
+    header.indexOffset = offset;
+    offset = alignOffset(offset + header.triangleCount * 3 * sizeof(uint32_t));
+    header.normalOffset = offset;
+    return offset + header.triangleCount * sizeof(Vec3D);
+}
+
+// a quick 64 bit hash, eight bytes per step so checking a big source file doesn't take longer than reading it
+static uint64_t hashBytes(const char *data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ull ^ size;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * 0x9e3779b97f4a7c15ull;
+        hash ^= hash >> 29;
+    }
+    for (; i < size; i++) {
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+MeshSourceInfo getMeshSourceInfo(const std::string &sourcePath, const char *data, size_t size) {
+    MeshSourceInfo info;
+    info.size = size;
+    std::error_code error;
+    auto modified = std::filesystem::last_write_time(sourcePath, error);
+    if (!error) info.modified = static_cast<int64_t>(modified.time_since_epoch().count());
+    info.hash = hashBytes(data, size);
+    return info;
+}
+
+std::string getMeshCachePath(const std::string &sourcePath) {
+    return sourcePath + ".rmesh";
+}
+
+bool loadMeshCache(const std::string &cachePath, const MeshSourceInfo &source, Mesh &mesh) {
+    auto file = std::make_shared<MappedFile>();
+    if (!file->open(cachePath) || file->size() < sizeof(RMeshHeader)) return false;
+
+    RMeshHeader header;
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (std::memcmp(header.magic, RMESH_MAGIC, sizeof(RMESH_MAGIC)) != 0 || header.version != RMESH_VERSION ||
+        header.byteOrder != RMESH_BYTE_ORDER) {
+        return false;
+    }
+    // stale cache
+    if (header.sourceSize != source.size || header.sourceModified != source.modified || header.sourceHash != source.hash) {
+        return false;
+    }
+    // make sure the arrays really are where the header says and inside the file
+    RMeshHeader expected = header;
+    if (header.vertexCount > UINT32_MAX || header.triangleCount > UINT32_MAX) return false;
+    if (layoutArrays(expected) > file->size() || std::memcmp(&expected, &header, sizeof(header)) != 0) return false;
+
+    const char *base = file->data();
+    size_t vertexCount = header.vertexCount;
+    size_t triangleCount = header.triangleCount;
+    // the indices are used without bounds checks from here on, so a damaged body has to be caught now. one pass over
+    // them is a few milliseconds for the biggest meshes, next to the hash of the source that's already done
+    const auto *indices = reinterpret_cast<const uint32_t *>(base + header.indexOffset);
+    uint32_t maxIndex = 0;
+    for (size_t i = 0; i < 3 * triangleCount; i++) maxIndex = std::max(maxIndex, indices[i]);
+    if (triangleCount > 0 && maxIndex >= vertexCount) return false;
+
+    mesh = Mesh(
+        {reinterpret_cast<const double *>(base + header.xOffset), vertexCount},
+        {reinterpret_cast<const double *>(base + header.yOffset), vertexCount},
+        {reinterpret_cast<const double *>(base + header.zOffset), vertexCount},
+        {indices, 3 * triangleCount},
+        {reinterpret_cast<const Vec3D *>(base + header.normalOffset), triangleCount},
+        Vec3D(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]),
+        Vec3D(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]),
+        file
+    );
+    return true;
+}
+
+// writes size bytes and pads the file up to offset with zeros
+static void writeArray(std::ofstream &out, uint64_t offset, const void *data, size_t size) {
+    static const char padding[RMESH_ALIGNMENT] = {};
+    out.write(padding, static_cast<std::streamsize>(offset - static_cast<uint64_t>(out.tellp())));
+    out.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+}
+
+bool writeMeshCache(const std::string &cachePath, const MeshSourceInfo &source, const Mesh &mesh) {
+    RMeshHeader header = {};
+    std::memcpy(header.magic, RMESH_MAGIC, sizeof(RMESH_MAGIC));
+    header.version = RMESH_VERSION;
+    header.byteOrder = RMESH_BYTE_ORDER;
+    header.sourceSize = source.size;
+    header.sourceModified = source.modified;
+    header.sourceHash = source.hash;
+    header.vertexCount = mesh.getVertexCount();
+    header.triangleCount = mesh.getTriangleCount();
+    header.boundsMin[0] = mesh.boundsMin.x;
+    header.boundsMin[1] = mesh.boundsMin.y;
+    header.boundsMin[2] = mesh.boundsMin.z;
+    header.boundsMax[0] = mesh.boundsMax.x;
+    header.boundsMax[1] = mesh.boundsMax.y;
+    header.boundsMax[2] = mesh.boundsMax.z;
+    layoutArrays(header);
+
+    // write to a temporary file and rename it, so a crash halfway through never leaves a broken cache behind
+    std::string tempPath = cachePath + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) return false;
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        writeArray(out, header.xOffset, mesh.x.data(), mesh.x.size_bytes());
+        writeArray(out, header.yOffset, mesh.y.data(), mesh.y.size_bytes());
+        writeArray(out, header.zOffset, mesh.z.data(), mesh.z.size_bytes());
+        writeArray(out, header.indexOffset, mesh.indices.data(), mesh.indices.size_bytes());
+        writeArray(out, header.normalOffset, mesh.normals.data(), mesh.normals.size_bytes());
+        if (!out) {
+            out.close();
+            std::error_code error;
+            std::filesystem::remove(tempPath, error);
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(tempPath, cachePath, error);
+    if (error) {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,41 @@
+//
+// Created by Cooper Stevens on 3/9/25.
+//
+
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <cstdint>
+#include <string>
+#include "Mesh.h"
+
+// a .rmesh file is a binary copy of a loaded mesh (after welding, fixing normals and any translation) stored next to
+// the .txt file it came from, so the next run can map it and use it as is instead of parsing the text again.
+// layout, in the byte order of the machine that wrote it:
+//   RMeshHeader
+//   x, y and z of every vertex (double), one array each
+//   three uint32_t indices per triangle
+//   one normal per triangle (three doubles)
+// every array starts on a 64 byte boundary
+
+// identifies the version of the source file a cache was made from
+struct MeshSourceInfo {
+    uint64_t size = 0;
+    int64_t modified = 0;
+    uint64_t hash = 0;
+};
+
+// size and modification time of the file, plus a hash of its contents (data, size bytes)
+MeshSourceInfo getMeshSourceInfo(const std::string &sourcePath, const char *data, size_t size);
+
+// the cache file that goes with a source file
+std::string getMeshCachePath(const std::string &sourcePath);
+
+// maps the cache and points mesh at it if the cache is valid and was made from this version of the source.
+// the mesh keeps the file mapped for as long as it (or a copy of it) is alive
+bool loadMeshCache(const std::string &cachePath, const MeshSourceInfo &source, Mesh &mesh);
+
+// writes mesh to the cache file. returns false if it can't be written
+bool writeMeshCache(const std::string &cachePath, const MeshSourceInfo &source, const Mesh &mesh);
+
+#endif
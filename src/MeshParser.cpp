@@ -0,0 +1,131 @@
+//
+// Created by Cooper Stevens on 3/2/25.
+//
+
+#include "MeshParser.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+#include <utility>
+
+#include "ThreadPool.h"
+#include "Tracer.h"
+
+// the characters the old line trimming removed
+static bool isLineSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// whitespace between numbers (what operator>> skips)
+static bool isNumberSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// reads the next number in [p, end) and moves p past it. like operator>>, leading whitespace and a + sign are allowed
+static bool parseNumber(const char *&p, const char *end, double &value) {
+    while (p < end && isNumberSpace(*p)) p++;
+    if (p < end && *p == '+' && p + 1 < end && *(p + 1) != '-') p++;
+    auto [next, error] = std::from_chars(p, end, value);
+    if (error != std::errc()) return false;
+    p = next;
+    return true;
+}
+
+// chunks are at least this big, so small files aren't split into pieces too small to be worth a job
+constexpr size_t MIN_CHUNK_SIZE = 256 * 1024;
+
+// what one chunk of the file parsed into
+struct ParsedChunk {
+    // nine coordinates per triangle, in file order
+    std::vector<double> corners;
+    // line (counted from the start of the chunk) and text of every invalid line
+    std::vector<std::pair<size_t, std::string_view>> invalidLines;
+    size_t lineCount = 0;
+    bool fixNormals = false;
+    Vec3D translation;
+};
+
+// parses the whole lines in [begin, end)
+static void parseChunk(const char *begin, const char *end, ParsedChunk &chunk) {
+    chunk = ParsedChunk();
+    const char *lineStart = begin;
+    while (lineStart < end) {
+        const char *newline = static_cast<const char *>(std::memchr(lineStart, '\n', end - lineStart));
+        const char *lineEnd = newline ? newline : end;
+        const char *next = newline ? newline + 1 : end;
+        ++chunk.lineCount;
+
+        // remove whitespace
+        const char *first = lineStart;
+        const char *last = lineEnd;
+        while (first < last && isLineSpace(*first)) first++;
+        while (last > first && isLineSpace(*(last - 1))) last--;
+        lineStart = next;
+
+        // skip empty lines
+        if (first == last || *first == '#') continue;
+        if (*first == '!') {chunk.fixNormals = true; continue;}
+        if (*first == '@') {
+            double t[3];
+            const char *p = first + 1;
+            bool valid = true;
+            for (int i = 0; i < 3 && valid; i++) valid = parseNumber(p, last, t[i]);
+            if (valid) chunk.translation = chunk.translation + Vec3D(t[0], t[1], t[2]);
+            else chunk.invalidLines.emplace_back(chunk.lineCount, std::string_view(first, last - first));
+            continue;
+        }
+
+        double v[9];
+        const char *p = first;
+        bool valid = true;
+        for (int i = 0; i < 9 && valid; i++) valid = parseNumber(p, last, v[i]);
+        if (!valid) {
+            chunk.invalidLines.emplace_back(chunk.lineCount, std::string_view(first, last - first));
+            continue;
+        }
+        chunk.corners.insert(chunk.corners.end(), v, v + 9);
+    }
+}
+
+MeshTextInfo parseMeshText(const char *begin, const char *end, MeshBuilder &builder) {
+    ThreadPool &pool = getThreadPool();
+    size_t size = end - begin;
+
+    // split the file into about four chunks per thread, moving each split forward to the start of the next line so
+    // every line is parsed by exactly one chunk
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(4 * pool.getThreadCount(), size / MIN_CHUNK_SIZE));
+    std::vector<const char *> splits = {begin};
+    for (size_t i = 1; i < chunkCount; i++) {
+        const char *split = std::max(splits.back(), begin + size * i / chunkCount);
+        const char *newline = static_cast<const char *>(std::memchr(split, '\n', end - split));
+        splits.push_back(newline ? newline + 1 : end);
+    }
+    splits.push_back(end);
+
+    std::vector<ParsedChunk> chunks(chunkCount);
+    pool.parallelFor(chunkCount, [&](size_t i) {
+        TRACE_SCOPE("parse-chunk", static_cast<int64_t>(i));
+        parseChunk(splits[i], splits[i + 1], chunks[i]);
+    });
+
+    // put the chunks back together in file order, so the mesh and the messages come out the same however many
+    // threads parsed it
+    MeshTextInfo info;
+    for (const auto &chunk : chunks) {
+        for (const auto &[line, text] : chunk.invalidLines) {
+            std::cerr << "(debug) invalid triangle format at line " << info.lineCount + line << ": " << text << std::endl;
+        }
+        for (size_t i = 0; i + 9 <= chunk.corners.size(); i += 9) {
+            const double *v = &chunk.corners[i];
+            builder.addTriangle(Vec3D(v[0], v[1], v[2]), Vec3D(v[3], v[4], v[5]), Vec3D(v[6], v[7], v[8]));
+        }
+        info.lineCount += chunk.lineCount;
+        info.invalidLines += chunk.invalidLines.size();
+        info.fixNormals = info.fixNormals || chunk.fixNormals;
+        info.translation = info.translation + chunk.translation;
+    }
+    return info;
+}
@@ -0,0 +1,27 @@
+//
+// Created by Cooper Stevens on 3/2/25.
+//
+
+#ifndef MESHPARSER_H
+#define MESHPARSER_H
+
+#include "Mesh.h"
+
+// what parseMeshText() found besides the triangles
+struct MeshTextInfo {
+    // a line starting with ! asks for ensureNormalsFaceOutward() to be run on the mesh
+    bool fixNormals = false;
+    // a line "@ x y z" asks for the mesh to be moved by (x, y, z). several of them add up
+    Vec3D translation;
+    size_t lineCount = 0;
+    size_t invalidLines = 0;
+};
+
+// parses the .txt mesh format (nine numbers per line, the three corners of a triangle) and adds every triangle to
+// builder. blank lines and lines starting with # are skipped. lines that aren't a valid triangle are reported on
+// std::cerr with their line number and skipped. numbers are read with std::from_chars straight out of the buffer,
+// so nothing is allocated per line. big files are split into chunks on line boundaries that are parsed in parallel,
+// then added to builder in file order, so the result doesn't depend on the number of threads
+MeshTextInfo parseMeshText(const char *begin, const char *end, MeshBuilder &builder);
+
+#endif
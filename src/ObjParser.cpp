@@ -0,0 +1,185 @@
+//
+// Created by Cooper Stevens on 3/11/25.
+//
+
+#include "ObjParser.h"
+
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string_view>
+
+// how much of the file is read at a time. lines longer than this make the buffer grow
+constexpr size_t BLOCK_SIZE = 1 << 20;
+
+// no vn given for a corner
+constexpr uint32_t NO_NORMAL = UINT32_MAX;
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// reads the next number in [p, end) and moves p past it, skipping leading whitespace. a + sign is allowed, but not
+// one followed by another sign (from_chars would read "+-1" as -1)
+static bool parseNumber(const char *&p, const char *end, double &value) {
+    while (p < end && isSpace(*p)) p++;
+    if (p < end && *p == '+' && p + 1 < end && *(p + 1) != '-') p++;
+    auto [next, error] = std::from_chars(p, end, value);
+    if (error != std::errc()) return false;
+    p = next;
+    return true;
+}
+
+// turns a 1 based or negative (relative) obj index into a 0 based one, given how many elements there are so far
+static bool resolveIndex(int64_t index, size_t count, uint32_t &resolved) {
+    // the negative case is compared as unsigned, since -index overflows for the smallest int64_t
+    if (index > 0 && static_cast<size_t>(index) <= count) resolved = static_cast<uint32_t>(index - 1);
+    else if (index < 0 && 0 - static_cast<uint64_t>(index) <= count) resolved = static_cast<uint32_t>(count + index);
+    else return false;
+    return true;
+}
+
+// everything that has to survive from one line (and one block of the file) to the next
+struct ObjState {
+    MeshData &data;
+    ObjInfo &info;
+    std::vector<Vec3D> vertexNormals;
+    // vertex and vn index of every corner of the face being read, reused between faces
+    std::vector<uint32_t> faceVertices;
+    std::vector<uint32_t> faceNormals;
+};
+
+// reads an obj index starting at p, moves p past it and resolves it against count elements
+static bool parseIndex(const char *&p, const char *end, size_t count, uint32_t &resolved) {
+    int64_t index;
+    auto [next, error] = std::from_chars(p, end, index);
+    if (error != std::errc() || !resolveIndex(index, count, resolved)) return false;
+    p = next;
+    return true;
+}
+
+// reads one corner of a face (v, v/vt, v//vn or v/vt/vn) and moves p past it
+static bool parseCorner(const char *&p, const char *end, ObjState &state, uint32_t &vertex, uint32_t &normal) {
+    normal = NO_NORMAL;
+    if (!parseIndex(p, end, state.data.vertices.size(), vertex)) return false;
+    if (p == end || *p != '/') return true;
+    // the texture coordinate isn't used
+    p++;
+    while (p < end && *p != '/' && !isSpace(*p)) p++;
+    if (p == end || *p != '/') return true;
+    p++;
+    return parseIndex(p, end, state.vertexNormals.size(), normal);
+}
+
+static void addTriangle(ObjState &state, size_t a, size_t b, size_t c) {
+    MeshData &data = state.data;
+    uint32_t ia = state.faceVertices[a], ib = state.faceVertices[b], ic = state.faceVertices[c];
+    Vec3D va(data.vertices.x[ia], data.vertices.y[ia], data.vertices.z[ia]);
+    Vec3D vb(data.vertices.x[ib], data.vertices.y[ib], data.vertices.z[ib]);
+    Vec3D vc(data.vertices.x[ic], data.vertices.y[ic], data.vertices.z[ic]);
+    Vec3D normal = (vb-va).cross(vc-va);
+    normal = normal * (1.0/normal.length());
+
+    // the winding in obj files isn't always consistent, but the vn normals say which side is the outside
+    uint32_t na = state.faceNormals[a], nb = state.faceNormals[b], nc = state.faceNormals[c];
+    if (na != NO_NORMAL && nb != NO_NORMAL && nc != NO_NORMAL) {
+        Vec3D given = state.vertexNormals[na] + state.vertexNormals[nb] + state.vertexNormals[nc];
+        if (normal.dot(given) < 0) normal = normal * (-1.0);
+    }
+
+    data.indices.push_back(ia);
+    data.indices.push_back(ib);
+    data.indices.push_back(ic);
+    data.normals.push_back(normal);
+}
+
+// parses one line, without its newline
+static void parseLine(const char *first, const char *last, ObjState &state) {
+    ++state.info.lineCount;
+    while (first < last && isSpace(*first)) first++;
+    while (last > first && isSpace(*(last - 1))) last--;
+    if (first == last || *first == '#') return;
+
+    const char *p = first;
+    while (p < last && !isSpace(*p)) p++;
+    std::string_view keyword(first, p - first);
+
+    bool valid = true;
+    if (keyword == "v") {
+        // a w coordinate or vertex color after x, y and z is ignored
+        double v[3];
+        for (int i = 0; i < 3 && valid; i++) valid = parseNumber(p, last, v[i]);
+        // indices are 32 bit, so vertices past that can't be used. they're reported rather than dropped quietly
+        valid = valid && state.data.vertices.size() < UINT32_MAX;
+        if (valid) {
+            state.data.vertices.x.push_back(v[0]);
+            state.data.vertices.y.push_back(v[1]);
+            state.data.vertices.z.push_back(v[2]);
+        }
+    } else if (keyword == "vn") {
+        double n[3];
+        for (int i = 0; i < 3 && valid; i++) valid = parseNumber(p, last, n[i]);
+        if (valid) state.vertexNormals.emplace_back(n[0], n[1], n[2]);
+    } else if (keyword == "f") {
+        state.faceVertices.clear();
+        state.faceNormals.clear();
+        while (valid) {
+            while (p < last && isSpace(*p)) p++;
+            if (p == last) break;
+            uint32_t vertex, normal;
+            valid = parseCorner(p, last, state, vertex, normal) && (p == last || isSpace(*p));
+            // vertex may never have been written
+            if (!valid) break;
+            state.faceVertices.push_back(vertex);
+            state.faceNormals.push_back(normal);
+        }
+        valid = valid && state.faceVertices.size() >= 3;
+        if (valid) {
+            ++state.info.faceCount;
+            // split the polygon into a fan of triangles around its first corner
+            for (size_t i = 1; i + 1 < state.faceVertices.size(); i++) addTriangle(state, 0, i, i + 1);
+        }
+    }
+    // every other record is something the renderer has no use for
+
+    if (!valid) {
+        ++state.info.invalidLines;
+        std::cerr << "(debug) invalid obj record at line " << state.info.lineCount << ": "
+                  << std::string_view(first, last - first) << std::endl;
+    }
+}
+
+bool parseObjFile(const std::string &filename, MeshData &data, ObjInfo &info) {
+    std::ifstream infile(filename, std::ios::binary);
+    if (!infile.is_open()) return false;
+
+    ObjState state = {data, info, {}, {}, {}};
+    std::vector<char> buffer(BLOCK_SIZE);
+    // bytes at the start of buffer, the unfinished last line of the previous block plus whatever was just read
+    size_t filled = 0;
+    while (true) {
+        infile.read(buffer.data() + filled, static_cast<std::streamsize>(buffer.size() - filled));
+        size_t read = static_cast<size_t>(infile.gcount());
+        bool finished = filled + read < buffer.size();
+        filled += read;
+
+        const char *lineStart = buffer.data();
+        const char *end = buffer.data() + filled;
+        while (const char *newline = static_cast<const char *>(std::memchr(lineStart, '\n', end - lineStart))) {
+            parseLine(lineStart, newline, state);
+            lineStart = newline + 1;
+        }
+        if (finished) {
+            // the last line doesn't have to end in a newline
+            if (lineStart < end) parseLine(lineStart, end, state);
+            break;
+        }
+
+        // move the unfinished line to the front, and make room if a single line filled the whole buffer
+        filled = end - lineStart;
+        std::memmove(buffer.data(), lineStart, filled);
+        if (filled == buffer.size()) buffer.resize(2 * buffer.size());
+    }
+    return !infile.bad();
+}
@@ -0,0 +1,28 @@
+//
+// Created by Cooper Stevens on 3/11/25.
+//
+
+#ifndef OBJPARSER_H
+#define OBJPARSER_H
+
+#include <string>
+#include "Mesh.h"
+
+// what parseObjFile() found besides the mesh
+struct ObjInfo {
+    size_t lineCount = 0;
+    size_t invalidLines = 0;
+    // faces in the file, before the ones with more than three corners are split into triangles
+    size_t faceCount = 0;
+};
+
+// reads a wavefront .obj file into data. v records are the vertices (obj files are already indexed, so they're used
+// as they are without welding) and every f record is split into a fan of triangles around its first corner. indices
+// start at 1 and negative ones count back from the last v or vn record before the face. the normal of each triangle
+// comes from its winding like in MeshBuilder, but when the face gives vn normals it's flipped to the side they point
+// to. other records (vt, g, o, usemtl...) are skipped and invalid lines are reported on std::cerr.
+// the file is read a block at a time, so only one block of it is ever in memory.
+// returns false if the file can't be opened
+bool parseObjFile(const std::string &filename, MeshData &data, ObjInfo &info);
+
+#endif
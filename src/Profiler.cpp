@@ -0,0 +1,149 @@
+//
+// Created by Cooper Stevens on 3/16/25.
+//
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+#include "DebugText.h"
+
+constexpr size_t STAGE_COUNT = static_cast<size_t>(ProfileStage::Count);
+
+const char *getProfileStageName(ProfileStage stage) {
+    static const char *names[STAGE_COUNT] = {
+        "frame", "events", "cull", "sort", "project", "draw", "hud", "clear", "upload", "present"
+    };
+    return names[static_cast<size_t>(stage)];
+}
+
+void Profiler::setEnabled(bool on) {
+#if RENDERER_PROFILING
+    std::lock_guard<std::mutex> lock(mutex);
+    if (on && !enabled.load()) {
+        // start over, so the history doesn't mix in frames from before it was turned off
+        current = {};
+        ran = {};
+        history = {};
+        frameCount = 0;
+    }
+    enabled.store(on);
+#endif
+}
+
+void Profiler::addTime(ProfileStage stage, double milliseconds) {
+    if (!isEnabled()) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    current[static_cast<size_t>(stage)] += milliseconds;
+    ran[static_cast<size_t>(stage)] = true;
+}
+
+void Profiler::addFrameStats(const FrameStats &stats) {
+    // an empty FrameStats means nothing was drawn, which shouldn't count as a frame with instant stages
+    if (!isEnabled() || (stats.trianglesTotal == 0 && stats.meshesHiZRejected == 0)) return;
+    addTime(ProfileStage::Cull, stats.cullTime);
+    addTime(ProfileStage::Sort, stats.sortTime);
+    addTime(ProfileStage::Project, stats.projectTime);
+    addTime(ProfileStage::Draw, stats.drawTime);
+}
+
+void Profiler::endFrame() {
+    if (!isEnabled()) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    // stages that didn't run this frame (nothing to redraw, say) keep their history, so an idle frame doesn't pull
+    // their averages toward zero
+    for (size_t i = 0; i < STAGE_COUNT; i++) {
+        if (!ran[i]) continue;
+        StageHistory &stage = history[i];
+        stage.samples[stage.next] = static_cast<float>(current[i]);
+        stage.next = (stage.next + 1) % HISTORY;
+        stage.count = std::min(stage.count + 1, HISTORY);
+    }
+    current = {};
+    ran = {};
+    frameCount++;
+}
+
+size_t Profiler::getFrameCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return frameCount;
+}
+
+double Profiler::getHistogramLimit(size_t bucket) {
+    // 1/16 ms, doubling up to 64 ms
+    return 0.0625 * static_cast<double>(1u << bucket);
+}
+
+StageSummary Profiler::getSummary(ProfileStage stage) const {
+    StageSummary summary;
+    std::vector<float> sorted;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const StageHistory &samples = history[static_cast<size_t>(stage)];
+        if (samples.count == 0) return summary;
+        sorted.assign(samples.samples.begin(), samples.samples.begin() + samples.count);
+        summary.last = samples.samples[(samples.next + HISTORY - 1) % HISTORY];
+    }
+
+    summary.samples = sorted.size();
+    for (float time : sorted) {
+        summary.mean += time;
+        size_t bucket = 0;
+        while (bucket + 1 < summary.histogram.size() && time >= getHistogramLimit(bucket)) bucket++;
+        summary.histogram[bucket]++;
+    }
+    summary.mean /= sorted.size();
+    std::sort(sorted.begin(), sorted.end());
+    summary.p50 = sorted[(sorted.size() - 1) / 2];
+    summary.p95 = sorted[(sorted.size() - 1) * 95 / 100];
+    summary.max = sorted.back();
+    return summary;
+}
+
+void Profiler::drawHud(Framebuffer &framebuffer) const {
+    if (!isEnabled()) return;
+    std::string text = "STAGE       LAST    AVG    P95    MAX MS\n";
+    char line[64];
+    for (size_t i = 0; i < STAGE_COUNT; i++) {
+        StageSummary summary = getSummary(static_cast<ProfileStage>(i));
+        if (summary.samples == 0) continue;
+        std::snprintf(line, sizeof(line), "%-8s %7.2f%7.2f%7.2f%7.2f\n", getProfileStageName(static_cast<ProfileStage>(i)),
+                      summary.last, summary.mean, summary.p95, summary.max);
+        text += line;
+    }
+
+    const int scale = 2;
+    int lines = static_cast<int>(std::count(text.begin(), text.end(), '\n'));
+    darkenRect(framebuffer, 0, 0, (40 * DEBUG_CHAR_WIDTH + 8) * scale, (lines * DEBUG_CHAR_HEIGHT + 6) * scale);
+    drawDebugText(framebuffer, 4 * scale, 4 * scale, text, sf::Color(120, 255, 120), scale);
+}
+
+bool Profiler::writeJson(const std::string &filename) const {
+    std::ofstream out(filename, std::ios::trunc);
+    if (!out.is_open()) return false;
+    out << "{\n  \"frames\": " << getFrameCount() << ",\n  \"history\": " << HISTORY << ",\n  \"histogramLimitsMs\": [";
+    StageSummary empty;
+    for (size_t bucket = 0; bucket + 1 < empty.histogram.size(); bucket++) {
+        out << (bucket ? ", " : "") << getHistogramLimit(bucket);
+    }
+    out << "],\n  \"stages\": {\n";
+    for (size_t i = 0; i < STAGE_COUNT; i++) {
+        StageSummary summary = getSummary(static_cast<ProfileStage>(i));
+        out << "    \"" << getProfileStageName(static_cast<ProfileStage>(i)) << "\": {\"samples\": " << summary.samples
+            << ", \"lastMs\": " << summary.last << ", \"meanMs\": " << summary.mean << ", \"p50Ms\": " << summary.p50
+            << ", \"p95Ms\": " << summary.p95 << ", \"maxMs\": " << summary.max << ", \"histogram\": [";
+        for (size_t bucket = 0; bucket < summary.histogram.size(); bucket++) {
+            out << (bucket ? ", " : "") << summary.histogram[bucket];
+        }
+        out << "]}" << (i + 1 < STAGE_COUNT ? "," : "") << "\n";
+    }
+    out << "  }\n}\n";
+    return static_cast<bool>(out);
+}
+
+Profiler &getProfiler() {
+    static Profiler profiler;
+    return profiler;
+}
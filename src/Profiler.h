@@ -0,0 +1,134 @@
+//
+// Created by Cooper Stevens on 3/16/25.
+//
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include "Framebuffer.h"
+#include "Rasterizer.h"
+#include "Tracer.h"
+
+// set to 0 (cmake -DRENDERER_PROFILING=OFF) to compile the timers out. the profiler then never turns on, so the
+// only thing left is a check of a constant at the end of each frame
+#ifndef RENDERER_PROFILING
+#define RENDERER_PROFILING 1
+#endif
+
+// the parts of a frame that get timed, in the order the hud lists them
+enum class ProfileStage {
+    // the whole loop iteration
+    Frame,
+    Events,
+    // the rasterizeMesh() stages (see FrameStats)
+    Cull,
+    Sort,
+    Project,
+    Draw,
+    Hud,
+    Clear,
+    Upload,
+    Present,
+    Count
+};
+
+const char *getProfileStageName(ProfileStage stage);
+
+// timing of one stage over the frames in the profiler's history
+struct StageSummary {
+    size_t samples = 0;
+    // milliseconds
+    double last = 0, mean = 0, p50 = 0, p95 = 0, max = 0;
+    // bucket i counts the samples below getHistogramLimit(i) (and at or above the limit before it). the last bucket
+    // has no upper limit
+    std::array<uint32_t, 12> histogram = {};
+};
+
+// collects per-stage frame times. times added during a frame are summed per stage and endFrame() stores the sums in a
+// ring buffer per stage holding the last HISTORY frames that stage ran in, which summaries and the histograms are
+// computed from. everything is thread safe: the render thread adds its stages to whichever of the main loop's frames
+// they finish in
+class Profiler {
+public:
+    static constexpr size_t HISTORY = 256;
+
+    void setEnabled(bool on);
+    bool isEnabled() const {
+#if RENDERER_PROFILING
+        return enabled.load(std::memory_order_relaxed);
+#else
+        return false;
+#endif
+    }
+
+    void addTime(ProfileStage stage, double milliseconds);
+    // adds the rasterizeMesh() stage times of a frame
+    void addFrameStats(const FrameStats &stats);
+    void endFrame();
+    // number of frames ended since the profiler was turned on
+    size_t getFrameCount() const;
+
+    StageSummary getSummary(ProfileStage stage) const;
+    static double getHistogramLimit(size_t bucket);
+
+    // draws a table of the stage times into the top left corner of the frame
+    void drawHud(Framebuffer &framebuffer) const;
+    // writes every stage's summary and histogram as json. returns false if the file can't be written
+    bool writeJson(const std::string &filename) const;
+
+private:
+    struct StageHistory {
+        std::array<float, HISTORY> samples = {};
+        size_t count = 0;
+        size_t next = 0;
+    };
+
+    std::atomic<bool> enabled = false;
+    mutable std::mutex mutex;
+    // this frame's time per stage so far, and whether the stage ran at all
+    std::array<double, static_cast<size_t>(ProfileStage::Count)> current = {};
+    std::array<bool, static_cast<size_t>(ProfileStage::Count)> ran = {};
+    std::array<StageHistory, static_cast<size_t>(ProfileStage::Count)> history;
+    size_t frameCount = 0;
+};
+
+Profiler &getProfiler();
+
+// adds the time between its construction and destruction to a stage, and records it as an event when a trace is
+// being captured. it doesn't even read the clock while both are off
+class ScopedTimer {
+public:
+    explicit ScopedTimer(ProfileStage stage) : stage(stage), active(getProfiler().isEnabled() || getTracer().isCapturing()) {
+        if (active) start = std::chrono::steady_clock::now();
+    }
+    ~ScopedTimer() {
+        if (!active) return;
+        auto end = std::chrono::steady_clock::now();
+        getProfiler().addTime(stage, std::chrono::duration<double, std::milli>(end - start).count());
+        getTracer().record(getProfileStageName(stage), start, end);
+    }
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+private:
+    ProfileStage stage;
+    bool active;
+    std::chrono::steady_clock::time_point start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#if RENDERER_PROFILING
+// times the rest of the enclosing scope as stage
+#define PROFILE_SCOPE(stage) ScopedTimer PROFILE_CONCAT(profileTimer, __LINE__)(stage)
+#else
+#define PROFILE_SCOPE(stage)
+#endif
+
+#endif
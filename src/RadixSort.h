@@ -0,0 +1,120 @@
+//
+// Created by Cooper Stevens on 3/19/25.
+//
+
+#ifndef RADIXSORT_H
+#define RADIXSORT_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include "FrameArena.h"
+#include "ThreadPool.h"
+
+// maps a float to a key whose unsigned integer order is the float's order, so floats can be radix sorted.
+// positive floats already compare like their bits, negative ones have their order flipped
+inline uint32_t getFloatSortKey(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits & 0x80000000u ? ~bits : bits | 0x80000000u;
+}
+
+// below this many items one thread sorts faster than splitting the work up
+constexpr size_t PARALLEL_RADIX_SORT_MIN = 1 << 16;
+
+// stable least significant digit radix sort on the uint32_t member `key` of each item, 8 bits per pass. the second
+// buffer and the digit counts come from arena, and the passes go back and forth between the two buffers, so the sorted
+// items end up in whichever one the last pass wrote to. that one is returned. passes where every key has the same digit
+// (like the top byte of depths that are all about the same size) are skipped, and big inputs are split across the
+// thread pool: every chunk counts its digits, and the chunks then scatter in parallel into the places the counts give
+// them, in chunk order, so the result is the same as sorting on one thread
+template <typename T>
+std::span<T> radixSort(std::span<T> items, FrameArena &arena) {
+    const size_t count = items.size();
+    // for a handful of items the counting costs more than an insertion sort, which is stable too
+    if (count <= 64) {
+        for (size_t i = 1; i < count; i++) {
+            T item = items[i];
+            size_t j = i;
+            for (; j > 0 && items[j - 1].key > item.key; j--) items[j] = items[j - 1];
+            items[j] = item;
+        }
+        return items;
+    }
+    std::span<T> scratch = arena.allocate<T>(count);
+
+    ThreadPool &pool = getThreadPool();
+    const size_t chunkCount = count >= PARALLEL_RADIX_SORT_MIN ? pool.getThreadCount() : 1;
+    const size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+    // digit counts per pass per chunk, 4 KB per chunk
+    auto counts = arena.allocate<std::array<std::array<uint32_t, 256>, 4>>(chunkCount);
+
+    // one read of the keys counts the digits for all four passes. the totals per digit stay the same whatever order
+    // the items are in, but how they're split between the chunks doesn't, so with more than one chunk every pass after
+    // the first counts its own digit again
+    auto countChunk = [&](size_t chunk) {
+        auto &chunkCounts = counts[chunk];
+        for (auto &pass : chunkCounts) pass.fill(0);
+        size_t end = std::min(count, (chunk + 1) * chunkSize);
+        for (size_t i = chunk * chunkSize; i < end; i++) {
+            uint32_t key = items[i].key;
+            chunkCounts[0][key & 0xFF]++;
+            chunkCounts[1][(key >> 8) & 0xFF]++;
+            chunkCounts[2][(key >> 16) & 0xFF]++;
+            chunkCounts[3][key >> 24]++;
+        }
+    };
+    if (chunkCount > 1) pool.parallelFor(chunkCount, countChunk);
+    else countChunk(0);
+
+    std::span<T> source = items, destination = scratch;
+    auto offsets = arena.allocate<std::array<uint32_t, 256>>(chunkCount);
+    bool countsMatchSource = true;
+    for (int pass = 0; pass < 4; pass++) {
+        // the same digit everywhere means this pass wouldn't move anything
+        uint32_t firstDigit = (items[0].key >> (8 * pass)) & 0xFF;
+        size_t sameDigit = 0;
+        for (size_t chunk = 0; chunk < chunkCount; chunk++) sameDigit += counts[chunk][pass][firstDigit];
+        if (sameDigit == count) continue;
+
+        const int shift = 8 * pass;
+        if (!countsMatchSource) {
+            pool.parallelFor(chunkCount, [&](size_t chunk) {
+                auto &passCounts = counts[chunk][pass];
+                passCounts.fill(0);
+                const T *in = source.data();
+                size_t end = std::min(count, (chunk + 1) * chunkSize);
+                for (size_t i = chunk * chunkSize; i < end; i++) passCounts[(in[i].key >> shift) & 0xFF]++;
+            });
+        }
+
+        // where each chunk's items with each digit start: all smaller digits first, then earlier chunks
+        uint32_t offset = 0;
+        for (int digit = 0; digit < 256; digit++) {
+            for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+                offsets[chunk][digit] = offset;
+                offset += counts[chunk][pass][digit];
+            }
+        }
+
+        auto scatterChunk = [&](size_t chunk) {
+            auto &chunkOffsets = offsets[chunk];
+            const T *in = source.data();
+            T *out = destination.data();
+            size_t end = std::min(count, (chunk + 1) * chunkSize);
+            for (size_t i = chunk * chunkSize; i < end; i++) {
+                out[chunkOffsets[(in[i].key >> shift) & 0xFF]++] = in[i];
+            }
+        };
+        if (chunkCount > 1) pool.parallelFor(chunkCount, scatterChunk);
+        else scatterChunk(0);
+        std::swap(source, destination);
+        countsMatchSource = chunkCount == 1;
+    }
+
+    return source;
+}
+
+#endif
@@ -0,0 +1,429 @@
+//
+// Created by Cooper Stevens on 2/3/25.
+//
+
+#include "RasterKernels.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "CpuFeatures.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RASTER_X86 1
+#endif
+
+// vertices are snapped to a grid of 1/16th of a pixel so the edge functions can be evaluated exactly with integers.
+// 4 bits is what keeps the edge values of a full screen triangle inside 32 bits for the simd kernels
+constexpr int SUBPIXEL_BITS = 4;
+constexpr int64_t SUBPIXEL_ONE = 1 << SUBPIXEL_BITS;
+
+// sets up E(p) = (v1 - v0) x (p - v0), which is positive on the inner side of the edge.
+// moving one pixel along x or y only adds a constant to it
+static EdgeSetup setupEdge(int64_t x0, int64_t y0, int64_t x1, int64_t y1) {
+    int64_t dx = x1 - x0;
+    int64_t dy = y1 - y0;
+    // screen y points down, so with a positive area a left edge goes up and a top edge is horizontal going right.
+    // pixels exactly on an edge are only drawn by the triangle whose top or left edge it is
+    bool topLeft = dy < 0 || (dy == 0 && dx > 0);
+    int64_t bias = topLeft ? 0 : -1;
+    return {-dy * SUBPIXEL_ONE, dx * SUBPIXEL_ONE, dy * x0 - dx * y0 + bias};
+}
+
+static int64_t evaluateEdge(const EdgeSetup &e, int i, int j) {
+    return e.stepX * i + e.stepY * j + e.offset;
+}
+
+bool setupTriangle(const Vec3D &A, const Vec3D &B, const Vec3D &C, int width, int height, TriangleSetup &tri) {
+    // we're trying to find the coordinates that creates the smallest rectangle that bounds the triangle completely
+
+    // we can't color in a pixel with a negative position, so set the lowest possible min to 0
+    tri.bounds.minX = std::max(0, static_cast<int>(std::min({A.x, B.x, C.x})));
+    // size of the window's x component in case the triangle takes up the entire screen
+    tri.bounds.maxX = std::min(width - 1, static_cast<int>(std::max({A.x, B.x, C.x})));
+    tri.bounds.minY = std::max(0, static_cast<int>(std::min({A.y, B.y, C.y})));
+    tri.bounds.maxY = std::min(height - 1, static_cast<int>(std::max({A.y, B.y, C.y})));
+    if (tri.bounds.minX > tri.bounds.maxX || tri.bounds.minY > tri.bounds.maxY) return false;
+
+    // snap to fixed point
+    int64_t ax = std::llround(A.x * SUBPIXEL_ONE), ay = std::llround(A.y * SUBPIXEL_ONE);
+    int64_t bx = std::llround(B.x * SUBPIXEL_ONE), by = std::llround(B.y * SUBPIXEL_ONE);
+    int64_t cx = std::llround(C.x * SUBPIXEL_ONE), cy = std::llround(C.y * SUBPIXEL_ONE);
+
+    // twice the signed area using the determinant
+    int64_t area = (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+    // degenerate (colinear or collapsed) triangles don't cover anything
+    if (area == 0) return false;
+    double depthA = A.z, depthB = B.z, depthC = C.z;
+    // make the winding consistent so every edge function is positive inside the triangle
+    if (area < 0) {
+        std::swap(bx, cx);
+        std::swap(by, cy);
+        std::swap(depthB, depthC);
+        area = -area;
+    }
+
+    tri.edges[0] = setupEdge(bx, by, cx, cy);
+    tri.edges[1] = setupEdge(cx, cy, ax, ay);
+    tri.edges[2] = setupEdge(ax, ay, bx, by);
+
+    // 1/depth is linear in screen space, so it's a plane through the three (snapped) vertices
+    double ex1 = static_cast<double>(bx - ax) / SUBPIXEL_ONE, ey1 = static_cast<double>(by - ay) / SUBPIXEL_ONE;
+    double ex2 = static_cast<double>(cx - ax) / SUBPIXEL_ONE, ey2 = static_cast<double>(cy - ay) / SUBPIXEL_ONE;
+    double pixelArea = ex1 * ey2 - ey1 * ex2;
+    double depthX = ((depthB - depthA) * ey2 - (depthC - depthA) * ey1) / pixelArea;
+    double depthY = ((depthC - depthA) * ex1 - (depthB - depthA) * ex2) / pixelArea;
+    double originX = tri.bounds.minX - static_cast<double>(ax) / SUBPIXEL_ONE;
+    double originY = tri.bounds.minY - static_cast<double>(ay) / SUBPIXEL_ONE;
+    tri.depth0 = static_cast<float>(depthA + depthX * originX + depthY * originY);
+    tri.depthX = static_cast<float>(depthX);
+    tri.depthY = static_cast<float>(depthY);
+
+    // edge functions are linear, so their extremes over the bounds are at its corners
+    tri.fitsInt32 = true;
+    for (const auto &e : tri.edges) {
+        for (int i : {tri.bounds.minX, tri.bounds.maxX}) {
+            for (int j : {tri.bounds.minY, tri.bounds.maxY}) {
+                int64_t value = evaluateEdge(e, i, j);
+                if (value < std::numeric_limits<int32_t>::min() || value > std::numeric_limits<int32_t>::max()) {
+                    tri.fitsInt32 = false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+uint32_t packColor(const sf::Color &color) {
+    const sf::Uint8 bytes[4] = {color.r, color.g, color.b, color.a};
+    uint32_t packed;
+    std::memcpy(&packed, bytes, sizeof(packed));
+    return packed;
+}
+
+//
+////
+// COVERAGE KERNELS
+////
+//
+
+// every kernel walks rect row by row. a triangle is convex, so the covered pixels of a row are one contiguous span
+// and a row can stop as soon as the kernel steps off the end of it.
+// with DepthTest the kernels also interpolate 1/depth and only write pixels that are closer than the depth buffer.
+// every kernel computes the depth of a pixel with the same float operations, so they all produce the same image
+
+using CoverageKernel = void (*)(const TriangleSetup &, const PixelRect &, uint32_t, const RasterTarget &);
+
+// depth at the start of row j, shared by all kernels. kept out of line so it isn't compiled with the avx512 kernel's
+// target flags, where the compiler would fuse it into an fma and round differently from the other kernels
+__attribute__((noinline))
+static float rowDepth(const TriangleSetup &tri, int j) {
+    return tri.depth0 + tri.depthY * static_cast<float>(j - tri.bounds.minY);
+}
+
+template <bool DepthTest>
+static void coverageScalar(const TriangleSetup &tri, const PixelRect &rect, uint32_t color, const RasterTarget &target) {
+    const EdgeSetup &e0 = tri.edges[0], &e1 = tri.edges[1], &e2 = tri.edges[2];
+    int64_t row0 = evaluateEdge(e0, rect.minX, rect.minY);
+    int64_t row1 = evaluateEdge(e1, rect.minX, rect.minY);
+    int64_t row2 = evaluateEdge(e2, rect.minX, rect.minY);
+
+    for (int j = rect.minY; j <= rect.maxY; j++) {
+        uint32_t *row = target.pixels + static_cast<size_t>(j) * target.pitch;
+        float *depthRow = DepthTest ? target.depth + static_cast<size_t>(j) * target.pitch : nullptr;
+        float depthStart = DepthTest ? rowDepth(tri, j) : 0.0f;
+        int64_t w0 = row0, w1 = row1, w2 = row2;
+        bool hit = false;
+        for (int i = rect.minX; i <= rect.maxX; i++) {
+            // inside when no edge value is negative
+            if ((w0 | w1 | w2) >= 0) {
+                hit = true;
+                if (DepthTest) {
+                    float depth = depthStart + tri.depthX * static_cast<float>(i - tri.bounds.minX);
+                    if (depth > depthRow[i]) {
+                        depthRow[i] = depth;
+                        row[i] = color;
+                    }
+                } else {
+                    row[i] = color;
+                }
+            } else if (hit) {
+                break;
+            }
+            w0 += e0.stepX;
+            w1 += e1.stepX;
+            w2 += e2.stepX;
+        }
+        row0 += e0.stepY;
+        row1 += e1.stepY;
+        row2 += e2.stepY;
+    }
+}
+
+#ifdef RASTER_X86
+
+template <bool DepthTest>
+__attribute__((target("sse2")))
+static void coverageSSE2(const TriangleSetup &tri, const PixelRect &rect, uint32_t color, const RasterTarget &target) {
+    const EdgeSetup &e0 = tri.edges[0], &e1 = tri.edges[1], &e2 = tri.edges[2];
+    // per lane offsets 0..3 steps along x. sse2 has no 32 bit multiply, so build them directly
+    const __m128i lane0 = _mm_setr_epi32(0, static_cast<int32_t>(e0.stepX), static_cast<int32_t>(2 * e0.stepX), static_cast<int32_t>(3 * e0.stepX));
+    const __m128i lane1 = _mm_setr_epi32(0, static_cast<int32_t>(e1.stepX), static_cast<int32_t>(2 * e1.stepX), static_cast<int32_t>(3 * e1.stepX));
+    const __m128i lane2 = _mm_setr_epi32(0, static_cast<int32_t>(e2.stepX), static_cast<int32_t>(2 * e2.stepX), static_cast<int32_t>(3 * e2.stepX));
+    const __m128i step0 = _mm_set1_epi32(static_cast<int32_t>(4 * e0.stepX));
+    const __m128i step1 = _mm_set1_epi32(static_cast<int32_t>(4 * e1.stepX));
+    const __m128i step2 = _mm_set1_epi32(static_cast<int32_t>(4 * e2.stepX));
+    const __m128i laneIndex = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128i minusOne = _mm_set1_epi32(-1);
+    const __m128i fill = _mm_set1_epi32(static_cast<int32_t>(color));
+    const __m128 depthX = _mm_set1_ps(tri.depthX);
+
+    int64_t row0 = evaluateEdge(e0, rect.minX, rect.minY);
+    int64_t row1 = evaluateEdge(e1, rect.minX, rect.minY);
+    int64_t row2 = evaluateEdge(e2, rect.minX, rect.minY);
+
+    for (int j = rect.minY; j <= rect.maxY; j++) {
+        uint32_t *row = target.pixels + static_cast<size_t>(j) * target.pitch;
+        float *depthRow = DepthTest ? target.depth + static_cast<size_t>(j) * target.pitch : nullptr;
+        const float depthStart = DepthTest ? rowDepth(tri, j) : 0.0f;
+        const __m128 depthRowStart = _mm_set1_ps(depthStart);
+        __m128i w0 = _mm_add_epi32(_mm_set1_epi32(static_cast<int32_t>(row0)), lane0);
+        __m128i w1 = _mm_add_epi32(_mm_set1_epi32(static_cast<int32_t>(row1)), lane1);
+        __m128i w2 = _mm_add_epi32(_mm_set1_epi32(static_cast<int32_t>(row2)), lane2);
+        bool hit = false;
+        for (int i = rect.minX; i <= rect.maxX; i += 4) {
+            __m128i inside = _mm_cmpgt_epi32(_mm_or_si128(w0, _mm_or_si128(w1, w2)), minusOne);
+            int remaining = rect.maxX - i + 1;
+            if (remaining < 4) inside = _mm_and_si128(inside, _mm_cmpgt_epi32(_mm_set1_epi32(remaining), laneIndex));
+            int bits = _mm_movemask_ps(_mm_castsi128_ps(inside));
+
+            if (bits == 0) {
+                if (hit) break;
+            } else if (remaining < 4) {
+                // don't touch memory past the end of the rect
+                hit = true;
+                for (int k = 0; k < remaining; k++) {
+                    if (!(bits & (1 << k))) continue;
+                    if (DepthTest) {
+                        float depth = depthStart + tri.depthX * static_cast<float>(i + k - tri.bounds.minX);
+                        if (!(depth > depthRow[i + k])) continue;
+                        depthRow[i + k] = depth;
+                    }
+                    row[i + k] = color;
+                }
+            } else {
+                hit = true;
+                if (DepthTest) {
+                    __m128i column = _mm_add_epi32(_mm_set1_epi32(i - tri.bounds.minX), laneIndex);
+                    __m128 depth = _mm_add_ps(depthRowStart, _mm_mul_ps(depthX, _mm_cvtepi32_ps(column)));
+                    __m128 oldDepth = _mm_loadu_ps(depthRow + i);
+                    __m128 closer = _mm_and_ps(_mm_castsi128_ps(inside), _mm_cmpgt_ps(depth, oldDepth));
+                    _mm_storeu_ps(depthRow + i, _mm_or_ps(_mm_and_ps(closer, depth), _mm_andnot_ps(closer, oldDepth)));
+                    inside = _mm_castps_si128(closer);
+                    bits = _mm_movemask_ps(closer);
+                }
+                __m128i *dst = reinterpret_cast<__m128i *>(row + i);
+                if (bits == 0xF) {
+                    _mm_storeu_si128(dst, fill);
+                } else if (bits != 0) {
+                    // sse2 has no cheap masked store, so blend with what's already there
+                    __m128i old = _mm_loadu_si128(dst);
+                    _mm_storeu_si128(dst, _mm_or_si128(_mm_and_si128(inside, fill), _mm_andnot_si128(inside, old)));
+                }
+            }
+            w0 = _mm_add_epi32(w0, step0);
+            w1 = _mm_add_epi32(w1, step1);
+            w2 = _mm_add_epi32(w2, step2);
+        }
+        row0 += e0.stepY;
+        row1 += e1.stepY;
+        row2 += e2.stepY;
+    }
+}
+
+template <bool DepthTest>
+__attribute__((target("avx2")))
+static void coverageAVX2(const TriangleSetup &tri, const PixelRect &rect, uint32_t color, const RasterTarget &target) {
+    const EdgeSetup &e0 = tri.edges[0], &e1 = tri.edges[1], &e2 = tri.edges[2];
+    const __m256i laneIndex = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i lane0 = _mm256_mullo_epi32(laneIndex, _mm256_set1_epi32(static_cast<int32_t>(e0.stepX)));
+    const __m256i lane1 = _mm256_mullo_epi32(laneIndex, _mm256_set1_epi32(static_cast<int32_t>(e1.stepX)));
+    const __m256i lane2 = _mm256_mullo_epi32(laneIndex, _mm256_set1_epi32(static_cast<int32_t>(e2.stepX)));
+    const __m256i step0 = _mm256_set1_epi32(static_cast<int32_t>(8 * e0.stepX));
+    const __m256i step1 = _mm256_set1_epi32(static_cast<int32_t>(8 * e1.stepX));
+    const __m256i step2 = _mm256_set1_epi32(static_cast<int32_t>(8 * e2.stepX));
+    const __m256i minusOne = _mm256_set1_epi32(-1);
+    const __m256i fill = _mm256_set1_epi32(static_cast<int32_t>(color));
+    const __m256 depthX = _mm256_set1_ps(tri.depthX);
+
+    int64_t row0 = evaluateEdge(e0, rect.minX, rect.minY);
+    int64_t row1 = evaluateEdge(e1, rect.minX, rect.minY);
+    int64_t row2 = evaluateEdge(e2, rect.minX, rect.minY);
+
+    for (int j = rect.minY; j <= rect.maxY; j++) {
+        uint32_t *row = target.pixels + static_cast<size_t>(j) * target.pitch;
+        float *depthRow = DepthTest ? target.depth + static_cast<size_t>(j) * target.pitch : nullptr;
+        const __m256 depthRowStart = _mm256_set1_ps(DepthTest ? rowDepth(tri, j) : 0.0f);
+        __m256i w0 = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int32_t>(row0)), lane0);
+        __m256i w1 = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int32_t>(row1)), lane1);
+        __m256i w2 = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int32_t>(row2)), lane2);
+        bool hit = false;
+        for (int i = rect.minX; i <= rect.maxX; i += 8) {
+            __m256i inside = _mm256_cmpgt_epi32(_mm256_or_si256(w0, _mm256_or_si256(w1, w2)), minusOne);
+            int remaining = rect.maxX - i + 1;
+            if (remaining < 8) inside = _mm256_and_si256(inside, _mm256_cmpgt_epi32(_mm256_set1_epi32(remaining), laneIndex));
+            int bits = _mm256_movemask_ps(_mm256_castsi256_ps(inside));
+
+            if (bits == 0) {
+                if (hit) break;
+            } else {
+                hit = true;
+                if (DepthTest) {
+                    __m256i column = _mm256_add_epi32(_mm256_set1_epi32(i - tri.bounds.minX), laneIndex);
+                    __m256 depth = _mm256_add_ps(depthRowStart, _mm256_mul_ps(depthX, _mm256_cvtepi32_ps(column)));
+                    __m256 oldDepth = _mm256_maskload_ps(depthRow + i, inside);
+                    __m256 closer = _mm256_and_ps(_mm256_castsi256_ps(inside), _mm256_cmp_ps(depth, oldDepth, _CMP_GT_OQ));
+                    inside = _mm256_castps_si256(closer);
+                    bits = _mm256_movemask_ps(closer);
+                    _mm256_maskstore_ps(depthRow + i, inside, depth);
+                }
+                if (bits == 0xFF) {
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(row + i), fill);
+                } else if (bits != 0) {
+                    // masked out lanes are never touched, even past the end of the row
+                    _mm256_maskstore_epi32(reinterpret_cast<int *>(row + i), inside, fill);
+                }
+            }
+            w0 = _mm256_add_epi32(w0, step0);
+            w1 = _mm256_add_epi32(w1, step1);
+            w2 = _mm256_add_epi32(w2, step2);
+        }
+        row0 += e0.stepY;
+        row1 += e1.stepY;
+        row2 += e2.stepY;
+    }
+}
+
+template <bool DepthTest>
+__attribute__((target("avx512f")))
+static void coverageAVX512(const TriangleSetup &tri, const PixelRect &rect, uint32_t color, const RasterTarget &target) {
+    const EdgeSetup &e0 = tri.edges[0], &e1 = tri.edges[1], &e2 = tri.edges[2];
+    const __m512i laneIndex = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m512i lane0 = _mm512_mullo_epi32(laneIndex, _mm512_set1_epi32(static_cast<int32_t>(e0.stepX)));
+    const __m512i lane1 = _mm512_mullo_epi32(laneIndex, _mm512_set1_epi32(static_cast<int32_t>(e1.stepX)));
+    const __m512i lane2 = _mm512_mullo_epi32(laneIndex, _mm512_set1_epi32(static_cast<int32_t>(e2.stepX)));
+    const __m512i step0 = _mm512_set1_epi32(static_cast<int32_t>(16 * e0.stepX));
+    const __m512i step1 = _mm512_set1_epi32(static_cast<int32_t>(16 * e1.stepX));
+    const __m512i step2 = _mm512_set1_epi32(static_cast<int32_t>(16 * e2.stepX));
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i fill = _mm512_set1_epi32(static_cast<int32_t>(color));
+    const __m512 depthX = _mm512_set1_ps(tri.depthX);
+
+    int64_t row0 = evaluateEdge(e0, rect.minX, rect.minY);
+    int64_t row1 = evaluateEdge(e1, rect.minX, rect.minY);
+    int64_t row2 = evaluateEdge(e2, rect.minX, rect.minY);
+
+    for (int j = rect.minY; j <= rect.maxY; j++) {
+        uint32_t *row = target.pixels + static_cast<size_t>(j) * target.pitch;
+        float *depthRow = DepthTest ? target.depth + static_cast<size_t>(j) * target.pitch : nullptr;
+        const __m512 depthRowStart = _mm512_set1_ps(DepthTest ? rowDepth(tri, j) : 0.0f);
+        __m512i w0 = _mm512_add_epi32(_mm512_set1_epi32(static_cast<int32_t>(row0)), lane0);
+        __m512i w1 = _mm512_add_epi32(_mm512_set1_epi32(static_cast<int32_t>(row1)), lane1);
+        __m512i w2 = _mm512_add_epi32(_mm512_set1_epi32(static_cast<int32_t>(row2)), lane2);
+        bool hit = false;
+        for (int i = rect.minX; i <= rect.maxX; i += 16) {
+            __mmask16 inside = _mm512_cmpge_epi32_mask(_mm512_or_si512(w0, _mm512_or_si512(w1, w2)), zero);
+            int remaining = rect.maxX - i + 1;
+            if (remaining < 16) inside &= static_cast<__mmask16>((1u << remaining) - 1);
+
+            if (inside == 0) {
+                if (hit) break;
+            } else {
+                hit = true;
+                if (DepthTest) {
+                    __m512i column = _mm512_add_epi32(_mm512_set1_epi32(i - tri.bounds.minX), laneIndex);
+                    // explicit rounding keeps the compiler from fusing these into an fma as well
+                    const int rounding = _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC;
+                    __m512 offset = _mm512_mul_round_ps(depthX, _mm512_cvtepi32_ps(column), rounding);
+                    __m512 depth = _mm512_add_round_ps(depthRowStart, offset, rounding);
+                    __m512 oldDepth = _mm512_maskz_loadu_ps(inside, depthRow + i);
+                    inside = _mm512_mask_cmp_ps_mask(inside, depth, oldDepth, _CMP_GT_OQ);
+                    _mm512_mask_storeu_ps(depthRow + i, inside, depth);
+                }
+                _mm512_mask_storeu_epi32(row + i, inside, fill);
+            }
+            w0 = _mm512_add_epi32(w0, step0);
+            w1 = _mm512_add_epi32(w1, step1);
+            w2 = _mm512_add_epi32(w2, step2);
+        }
+        row0 += e0.stepY;
+        row1 += e1.stepY;
+        row2 += e2.stepY;
+    }
+}
+
+#endif
+
+//
+////
+// DISPATCH
+////
+//
+
+struct KernelEntry {
+    const char *name;
+    CoverageKernel kernel;
+    CoverageKernel depthKernel;
+    bool supported;
+};
+
+static std::vector<KernelEntry> getKernelTable() {
+    std::vector<KernelEntry> table = {{"scalar", coverageScalar<false>, coverageScalar<true>, true}};
+#ifdef RASTER_X86
+    const CpuFeatures &cpu = getCpuFeatures();
+    table.push_back({"sse2", coverageSSE2<false>, coverageSSE2<true>, cpu.sse2});
+    table.push_back({"avx2", coverageAVX2<false>, coverageAVX2<true>, cpu.avx2});
+    table.push_back({"avx512", coverageAVX512<false>, coverageAVX512<true>, cpu.avx512});
+#endif
+    return table;
+}
+
+// widest kernel the cpu supports. the table is ordered narrowest to widest
+static KernelEntry pickBestKernel() {
+    KernelEntry best = getKernelTable().front();
+    for (const auto &entry : getKernelTable()) {
+        if (entry.supported) best = entry;
+    }
+    return best;
+}
+
+// chosen once at startup
+static KernelEntry activeKernel = pickBestKernel();
+
+void drawTriangle(const TriangleSetup &tri, const PixelRect &rect, uint32_t color, const RasterTarget &target) {
+    // the simd kernels work on 32 bit lanes. the rare triangle too big for that goes through the 64 bit scalar path
+    if (!tri.fitsInt32) {
+        if (target.depth) coverageScalar<true>(tri, rect, color, target);
+        else coverageScalar<false>(tri, rect, color, target);
+        return;
+    }
+    if (target.depth) activeKernel.depthKernel(tri, rect, color, target);
+    else activeKernel.kernel(tri, rect, color, target);
+}
+
+const char *getCoverageKernelName() {
+    return activeKernel.name;
+}
+
+bool setCoverageKernel(const std::string &name) {
+    for (const auto &entry : getKernelTable()) {
+        if (entry.name == name && entry.supported) {
+            activeKernel = entry;
+            return true;
+        }
+    }
+    return false;
+}
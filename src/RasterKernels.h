@@ -0,0 +1,61 @@
+//
+// Created by Cooper Stevens on 2/3/25.
+//
+
+#ifndef RASTERKERNELS_H
+#define RASTERKERNELS_H
+
+#include <cstdint>
+#include <string>
+#include "LinAlg.h"
+
+// inclusive pixel rectangle
+struct PixelRect {
+    int minX, minY, maxX, maxY;
+};
+
+// a block of 32 bit RGBA8 pixels the kernels write straight into
+struct RasterTarget {
+    uint32_t *pixels;
+    int width, height;
+    // distance between rows, in pixels
+    int pitch;
+    // optional depth buffer with the same layout as pixels, holding 1/depth of the closest surface drawn so far.
+    // when it's set a pixel is only written if it's closer than what's already there
+    float *depth = nullptr;
+};
+
+// edge function E(i, j) = stepX * i + stepY * j + offset for the pixel sample at (i, j).
+// the top-left fill rule bias is folded into the offset, so a pixel is covered when all three values are >= 0
+struct EdgeSetup {
+    int64_t stepX, stepY, offset;
+};
+
+struct TriangleSetup {
+    EdgeSetup edges[3];
+    PixelRect bounds;
+    // depth plane relative to the top left of bounds: depth(i, j) = depth0 + depthX * (i - minX) + depthY * (j - minY).
+    // measuring from the triangle instead of from the rect being drawn keeps the result the same however it's clipped
+    float depth0, depthX, depthY;
+    // true when every edge value inside the bounds fits in 32 bits, which the simd kernels rely on
+    bool fitsInt32;
+};
+
+// snaps the triangle to fixed point and sets up its edge functions. x and y are screen coordinates and z is the 1/depth
+// value from getProjectedPoint(). returns false for degenerate triangles and ones that don't touch the width x height target
+bool setupTriangle(const Vec3D &A, const Vec3D &B, const Vec3D &C, int width, int height, TriangleSetup &tri);
+
+// writes color into every pixel of rect covered by the triangle (and closer than the depth buffer, if the target has
+// one). rect has to lie inside tri.bounds
+void drawTriangle(const TriangleSetup &tri, const PixelRect &rect, uint32_t color, const RasterTarget &target);
+
+// packs a color into the byte order sf::Texture and sf::Image store pixels in
+uint32_t packColor(const sf::Color &color);
+
+// name of the coverage kernel drawTriangle dispatches to ("scalar", "sse2", "avx2" or "avx512")
+const char *getCoverageKernelName();
+
+// forces a specific kernel, for benchmarking and debugging. returns false if this cpu can't run it
+bool setCoverageKernel(const std::string &name);
+
+#endif
@@ -5,149 +5,379 @@
 #include <tuple>
 #include <array>
 #include <algorithm>
+#include <chrono>
 
 #include "Rasterizer.h"
+#include "FrameArena.h"
+#include "RadixSort.h"
+#include "ThreadPool.h"
+#include "Tracer.h"
 
 #include <iostream>
 #include <unordered_set>
 
-// fills in all pixels within a triangle. uses the barycentric coordinates method to determine if pixels are bounded by the triangle
-void fillTriangle(const Vec2D &A, const Vec2D &B, const Vec2D &C, const sf::Color &color, sf::Image &image) {
-    // we're trying to find the coordinates that creates the smallest rectangle that bounds the triangle completely
-
-    // we can't color in a pixel with a negative position, so set the lowest possible min to 0
-    int minX = std::max(0, static_cast<int>(std::min({A.x, B.x, C.x})));
-    // size of the window's x component in case the triangle takes up the entire screen
-    int maxX = std::min(static_cast<int>(image.getSize().x - 1), static_cast<int>(std::max({A.x, B.x, C.x})));
-    int minY = std::max(0, static_cast<int>(std::min({A.y, B.y, C.y})));
-    int maxY = std::min(static_cast<int>(image.getSize().y - 1), static_cast<int>(std::max({A.y, B.y, C.y})));
-
-    // area using determinant
-    double area = Matrix2x2(B-A, C-A).det();
-
-    // iterate through the bounds the triangle lies in
-    for (int i = minX; i <= maxX; i++) {
-        for (int j = minY; j <= maxY; j++) {
-            // get barycentric coordinates
-            double w1 = ((B.x - i) * (C.y - j) - (C.x - i) * (B.y - j)) / area;
-            double w2 = ((C.x - i) * (A.y - j) - (A.x - i) * (C.y - j)) / area;
-            double w3 = 1.0 - w1 - w2;
-            // check if the point is inside the triangle
-            if (w1 >= 0 && w2 >= 0 && w3 >= 0) {
-                image.setPixel(i, j, color);
+// fills in all pixels within a triangle. the coverage test itself lives in RasterKernels, which tests
+// several pixels per instruction with the widest simd kernel this cpu supports
+void fillTriangle(const Vec3D &A, const Vec3D &B, const Vec3D &C, const sf::Color &color, const RasterTarget &target) {
+    TriangleSetup tri;
+    if (!setupTriangle(A, B, C, target.width, target.height, tri)) return;
+    drawTriangle(tri, tri.bounds, packColor(color), target);
+}
+
+
+// a front facing triangle that made it past culling, with its shaded color and its sort key (see getFloatSortKey())
+struct RasterTriangle {
+    uint32_t index;
+    uint32_t color;
+    uint32_t key;
+};
+
+static Vec3D getScreenVertex(const VertexStreams &screen, size_t i) {
+    return {screen.x[i], screen.y[i], screen.z[i]};
+}
+
+// projects every vertex of the mesh with projectPoints(). a few thousand vertices per job keeps the pool busy for
+// meshes with millions of vertices without splitting small meshes into pieces too small to be worth it.
+// a compact mesh goes through the float pipeline: its decode is folded into the view projection, so the stored values
+// are projected as they are. 16 bit values are turned into floats (which is exact) a few hundred at a time into
+// buffers on the stack that stay in the cache until they're projected
+static void projectVertices(const ViewState &view, const Mesh &mesh, VertexStreams &screen) {
+    const size_t chunkSize = 16384;
+    const size_t decodeBlockSize = 512;
+    size_t count = mesh.getVertexCount();
+    screen.resize(count);
+    Matrix4x4F toClip(view.viewProjection * mesh.getDecodeTransform());
+    getThreadPool().parallelFor((count + chunkSize - 1) / chunkSize, [&](size_t chunk) {
+        TRACE_SCOPE("project-vertices", static_cast<int64_t>(chunk));
+        size_t begin = chunk * chunkSize;
+        size_t end = std::min(count, begin + chunkSize);
+        switch (mesh.format) {
+            case MeshFormat::Double:
+                projectPoints(view, mesh.x.data() + begin, mesh.y.data() + begin, mesh.z.data() + begin, end - begin,
+                              screen.x.data() + begin, screen.y.data() + begin, screen.z.data() + begin);
+                break;
+            case MeshFormat::Float:
+                projectPoints(view, toClip, mesh.floatX.data() + begin, mesh.floatY.data() + begin,
+                              mesh.floatZ.data() + begin, end - begin, screen.x.data() + begin,
+                              screen.y.data() + begin, screen.z.data() + begin);
+                break;
+            case MeshFormat::Quantized16: {
+                float x[decodeBlockSize], y[decodeBlockSize], z[decodeBlockSize];
+                for (size_t block = begin; block < end; block += decodeBlockSize) {
+                    size_t n = std::min(end, block + decodeBlockSize) - block;
+                    mesh.widenQuantizedVertices(block, n, x, y, z);
+                    projectPoints(view, toClip, x, y, z, n, screen.x.data() + block, screen.y.data() + block,
+                                  screen.z.data() + block);
+                }
+                break;
+            }
+        }
+    });
+}
+
+// the largest pyramid level whose cells line up with the tiles, so each thread only touches cells of its own tile.
+// -1 if the tile size isn't a multiple of the pyramid's cells
+static int getTilePyramidLevel(int tileSize) {
+    int level = -1;
+    while (tileSize % (DepthPyramid::CELL_SIZE << (level + 1)) == 0) level++;
+    return level;
+}
+
+// splits the screen into tileSize x tileSize tiles and bins each projected triangle into every tile its bounding
+// rectangle overlaps. the tiles are then drawn in parallel. each tile draws its triangles in the same order as the
+// single threaded loop and only ever touches its own pixels, so the output is identical, and a 64x64 tile of
+// pixels stays in cache while it's being drawn
+static void rasterizeTiled(const Mesh &mesh, std::span<const RasterTriangle> tris, const VertexStreams &screen, const RasterTarget &target, DepthPyramid *pyramid, int tileSize, FrameArena &arena, FrameStats &stats) {
+    ThreadPool &pool = getThreadPool();
+
+    int pyramidLevel = getTilePyramidLevel(tileSize);
+    if (pyramidLevel < 0) pyramid = nullptr;
+
+    // set up every triangle. this is independent per triangle, so it's split across the pool in chunks
+    const size_t chunkSize = 256;
+    auto setups = arena.allocate<TriangleSetup>(tris.size());
+    auto drawable = arena.allocate<char>(tris.size());
+    // largest 1/depth of each triangle, for the depth pyramid test
+    auto nearest = arena.allocate<float>(tris.size());
+    pool.parallelFor((tris.size() + chunkSize - 1) / chunkSize, [&](size_t chunk) {
+        TRACE_SCOPE("setup-triangles", static_cast<int64_t>(chunk));
+        size_t end = std::min(tris.size(), (chunk + 1) * chunkSize);
+        for (size_t i = chunk * chunkSize; i < end; i++) {
+            const uint32_t *corners = &mesh.indices[3 * static_cast<size_t>(tris[i].index)];
+            Vec3D projectedVert1 = getScreenVertex(screen, corners[0]);
+            Vec3D projectedVert2 = getScreenVertex(screen, corners[1]);
+            Vec3D projectedVert3 = getScreenVertex(screen, corners[2]);
+            drawable[i] = setupTriangle(projectedVert1, projectedVert2, projectedVert3, target.width, target.height, setups[i]);
+            nearest[i] = static_cast<float>(std::max({projectedVert1.z, projectedVert2.z, projectedVert3.z}));
+        }
+    });
+
+    // bin triangles in draw order. the bins are one array with each tile's triangles after the last tile's, so they're
+    // counted first to find where each tile starts, then filled in
+    int tilesX = (target.width + tileSize - 1) / tileSize;
+    int tilesY = (target.height + tileSize - 1) / tileSize;
+    size_t tileCount = static_cast<size_t>(tilesX) * tilesY;
+    // where each tile's triangles start, plus the end of the last one
+    auto binStart = arena.allocate<uint32_t>(tileCount + 1);
+    // how many tiles each triangle went into
+    auto binCount = arena.allocate<uint32_t>(tris.size());
+    std::span<uint32_t> bins;
+    {
+        TRACE_SCOPE("bin");
+        std::fill(binStart.begin(), binStart.end(), 0);
+        for (size_t i = 0; i < tris.size(); i++) {
+            binCount[i] = 0;
+            if (!drawable[i]) continue;
+            const PixelRect &bounds = setups[i].bounds;
+            for (int ty = bounds.minY / tileSize; ty <= bounds.maxY / tileSize; ty++) {
+                for (int tx = bounds.minX / tileSize; tx <= bounds.maxX / tileSize; tx++) {
+                    binStart[static_cast<size_t>(ty) * tilesX + tx + 1]++;
+                    binCount[i]++;
+                }
+            }
+        }
+        for (size_t tile = 0; tile < tileCount; tile++) binStart[tile + 1] += binStart[tile];
+
+        bins = arena.allocate<uint32_t>(binStart[tileCount]);
+        auto binEnd = arena.allocate<uint32_t>(tileCount);
+        std::copy(binStart.begin(), binStart.end() - 1, binEnd.begin());
+        for (size_t i = 0; i < tris.size(); i++) {
+            if (!drawable[i]) continue;
+            const PixelRect &bounds = setups[i].bounds;
+            for (int ty = bounds.minY / tileSize; ty <= bounds.maxY / tileSize; ty++) {
+                for (int tx = bounds.minX / tileSize; tx <= bounds.maxX / tileSize; tx++) {
+                    bins[binEnd[static_cast<size_t>(ty) * tilesX + tx]++] = static_cast<uint32_t>(i);
+                }
+            }
+        }
+    }
+
+    // triangles each tile threw away with the depth pyramid. a tile can't throw away more than it was given, so each
+    // one writes into the same part of this array that its bin has in bins
+    std::span<uint32_t> hiZRejected, rejectedCount;
+    if (pyramid) {
+        hiZRejected = arena.allocate<uint32_t>(bins.size());
+        rejectedCount = arena.allocate<uint32_t>(tileCount);
+        std::fill(rejectedCount.begin(), rejectedCount.end(), 0);
+    }
+
+    // draw the tiles
+    pool.parallelFor(tileCount, [&](size_t tile) {
+        TRACE_SCOPE("rasterize-tile", static_cast<int64_t>(tile));
+        int tx = static_cast<int>(tile % tilesX);
+        int ty = static_cast<int>(tile / tilesX);
+        PixelRect tileRect = {
+            tx * tileSize,
+            ty * tileSize,
+            std::min(target.width, (tx + 1) * tileSize) - 1,
+            std::min(target.height, (ty + 1) * tileSize) - 1
+        };
+        for (size_t entry = binStart[tile]; entry < binStart[tile + 1]; entry++) {
+            uint32_t i = bins[entry];
+            const TriangleSetup &tri = setups[i];
+            PixelRect rect = {
+                std::max(tileRect.minX, tri.bounds.minX),
+                std::max(tileRect.minY, tri.bounds.minY),
+                std::min(tileRect.maxX, tri.bounds.maxX),
+                std::min(tileRect.maxY, tri.bounds.maxY)
+            };
+            if (pyramid) {
+                if (pyramid->isOccluded(rect, nearest[i], target.depth, target.pitch, pyramidLevel)) {
+                    hiZRejected[binStart[tile] + rejectedCount[tile]++] = i;
+                    continue;
+                }
+                drawTriangle(tri, rect, tris[i].color, target);
+                pyramid->markDrawn(rect, pyramidLevel);
+            } else {
+                drawTriangle(tri, rect, tris[i].color, target);
+            }
+        }
+    });
+
+    if (pyramid) {
+        pyramid->markLevelsAboveDrawn(pyramidLevel);
+        // a triangle only counts as rejected if every tile it was binned into threw it away
+        auto rejectCount = arena.allocate<uint32_t>(tris.size());
+        std::fill(rejectCount.begin(), rejectCount.end(), 0);
+        for (size_t tile = 0; tile < tileCount; tile++) {
+            for (size_t entry = binStart[tile]; entry < binStart[tile] + rejectedCount[tile]; entry++) {
+                uint32_t i = hiZRejected[entry];
+                if (++rejectCount[i] == binCount[i]) stats.hiZRejected++;
             }
         }
     }
 }
 
+// tests the mesh's bounding box against the depth pyramid, so a mesh hidden behind what's already been drawn
+// can be skipped without looking at any of its triangles
+static bool isMeshOccluded(const Mesh &mesh, const ViewState &view, DepthBuffer &depthBuffer) {
+    double minX = view.width, minY = view.height, maxX = 0, maxY = 0;
+    double nearest = 0;
+    for (int corner = 0; corner < 8; corner++) {
+        Vec3D v(corner & 1 ? mesh.boundsMax.x : mesh.boundsMin.x,
+                corner & 2 ? mesh.boundsMax.y : mesh.boundsMin.y,
+                corner & 4 ? mesh.boundsMax.z : mesh.boundsMin.z);
+        Vec3D projected = view.project(v);
+        // the projection of a point behind the camera says nothing about where the box is on screen
+        if (projected.z <= 0) return false;
+        minX = std::min(minX, projected.x);
+        minY = std::min(minY, projected.y);
+        maxX = std::max(maxX, projected.x);
+        maxY = std::max(maxY, projected.y);
+        nearest = std::max(nearest, projected.z);
+    }
+    PixelRect rect = {
+        static_cast<int>(minX),
+        static_cast<int>(minY),
+        std::min(static_cast<int>(maxX), depthBuffer.width - 1),
+        std::min(static_cast<int>(maxY), depthBuffer.height - 1)
+    };
+    if (rect.minX > rect.maxX || rect.minY > rect.maxY) return false;
+    return depthBuffer.pyramid.isOccluded(rect, static_cast<float>(nearest), depthBuffer.values.data(), depthBuffer.width, depthBuffer.pyramid.getLevelCount());
+}
 
-void rasterizeMesh(const Mesh &mesh, const Vec3D &cam, sf::Image &image, Vec3D lightSource, double camAngleX, double camAngleY) {
-    std::vector<Triangle3D> rasterizableTris;
+void rasterizeMesh(const Mesh &mesh, const ViewState &view, Framebuffer &framebuffer, DepthBuffer *depthBuffer, RasterScratch &scratch, Vec3D lightSource, const RenderOptions &options, FrameStats *stats) {
+    const Vec3D &cam = view.cameraPos;
+    FrameStats frameStats;
+
+    // everything below that only lives until this mesh is drawn comes from here, so once the arena has grown to the
+    // biggest mesh a frame doesn't allocate. nothing from the last call is still in use
+    FrameArena &arena = scratch.arena;
+    arena.reset();
+
+    // adds the time since the last stage ended to a stage's counter, and to the trace if one is being captured. a
+    // clock read per stage is nothing next to the stages themselves. the counters are kept with
+    // RENDERER_PROFILING=OFF, since the replay and RendererBench report them, but the trace events aren't
+    auto stageStart = std::chrono::steady_clock::now();
+    auto endStage = [&](double &stageTime, const char *name) {
+        auto now = std::chrono::steady_clock::now();
+        stageTime += std::chrono::duration<double, std::milli>(now - stageStart).count();
+#if RENDERER_PROFILING
+        getTracer().record(name, stageStart, now);
+#endif
+        stageStart = now;
+    };
+
+    RasterTarget target = framebuffer.getTarget();
+    bool useDepthBuffer = options.depthMode != DepthMode::PainterSort && depthBuffer;
+    if (useDepthBuffer) target.depth = depthBuffer->values.data();
+    DepthPyramid *pyramid = useDepthBuffer && options.hiZ ? &depthBuffer->pyramid : nullptr;
+
+    // back to front for the painter's algorithm, front to back for the depth buffer, or no order at all
+    bool sortTriangles = !useDepthBuffer || options.depthMode == DepthMode::ZBufferFrontToBack;
+    uint32_t keyFlip = useDepthBuffer ? 0 : ~0u;
+
+    frameStats.trianglesTotal = mesh.getTriangleCount();
+    if (pyramid && isMeshOccluded(mesh, view, *depthBuffer)) {
+        frameStats.meshesHiZRejected++;
+        endStage(frameStats.cullTime, "cull");
+        if (stats) *stats += frameStats;
+        return;
+    }
 
-    for (auto &tri : mesh.surfaceTriangles) {
-        Vec3D centroid = (tri.a + tri.b + tri.c) * (1.0 / 3.0);
+    // room for every triangle, the ones that make it past culling are packed at the front
+    auto rasterizableTris = arena.allocate<RasterTriangle>(mesh.getTriangleCount());
+    size_t rasterizableCount = 0;
+    // a compact mesh's normals and corners are decoded a block of triangles at a time into arrays on the stack (see
+    // Mesh::decodeNormals() and Mesh::decodeCorners()), so neither ever exists decoded for the whole mesh
+    const size_t blockSize = 256;
+    double normalX[blockSize], normalY[blockSize], normalZ[blockSize];
+    double cornerX[3 * blockSize], cornerY[3 * blockSize], cornerZ[3 * blockSize];
+    bool decodeBlocks = mesh.format != MeshFormat::Double;
+    auto getCorner = [&](size_t triangle, size_t inBlock, int corner) {
+        if (decodeBlocks) {
+            size_t j = 3 * inBlock + corner;
+            return Vec3D(cornerX[j], cornerY[j], cornerZ[j]);
+        }
+        uint32_t vertex = mesh.indices[3 * triangle + corner];
+        return Vec3D(mesh.x[vertex], mesh.y[vertex], mesh.z[vertex]);
+    };
+    for (size_t i = 0; i < mesh.getTriangleCount(); i++) {
+        size_t inBlock = i % blockSize;
+        if (decodeBlocks && inBlock == 0) {
+            size_t count = std::min(blockSize, mesh.getTriangleCount() - i);
+            mesh.decodeNormals(i, count, normalX, normalY, normalZ);
+            mesh.decodeCorners(i, count, cornerX, cornerY, cornerZ);
+        }
+        Vec3D normal = decodeBlocks ? Vec3D(normalX[inBlock], normalY[inBlock], normalZ[inBlock]) : mesh.normals[i];
+        // the same sum as Mesh::getCentroid()
+        Vec3D centroid = (getCorner(i, inBlock, 0) + getCorner(i, inBlock, 1) + getCorner(i, inBlock, 2)) * (1.0 / 3.0);
         // vector from the camera to the centroid
         Vec3D viewVector = centroid - cam;
 
-        if (tri.normal.dot(viewVector) > -0.0001) {
+        if (normal.dot(viewVector) > -0.0001) {
             // cull triangle if it is facing away from the camera
             // (backface culling)
+            frameStats.backfaceCulled++;
             continue;
         }
 
-        if (tri.normal.dot(viewVector) < 0.0001) {
+        if (normal.dot(viewVector) < 0.0001) {
             // normalize light source position vector
             lightSource = lightSource * (1.0 / lightSource.length());
             // get "lighting factor". we'll use this to determine how much to shade in triangles
-            double lightingFactor = std::max(0.0, tri.normal.dot(lightSource));
+            double lightingFactor = std::max(0.0, normal.dot(lightSource));
 
             // get color. color gets darker as dot product decreases (color gets darker as angle between the triangle's normal and the light source increases)
             sf::Uint8 gray = static_cast<sf::Uint8>(lightingFactor * 255);
-            tri.color = sf::Color(gray, gray, gray);
 
-            // put triangle in vector to be rasterized
-            rasterizableTris.push_back(tri);
+            // the squared distance sorts the same as the distance without the square root. flipping the bits of the key
+            // turns an ascending sort into a descending one
+            uint32_t key = sortTriangles ? getFloatSortKey(static_cast<float>(viewVector.dot(viewVector))) ^ keyFlip : 0;
+
+            // put triangle in the list to be rasterized
+            rasterizableTris[rasterizableCount++] = {static_cast<uint32_t>(i), packColor(sf::Color(gray, gray, gray)), key};
         }
     }
+    rasterizableTris = rasterizableTris.first(rasterizableCount);
 
-    // sort triangles by depth
-    // we'll have visual bugs if triangles that are behind other triangles are rasterized first
-    std::sort(rasterizableTris.begin(), rasterizableTris.end(), [cam](const Triangle3D &tri1, const Triangle3D &tri2) {
-        double z1 = ((tri1.a + tri1.b + tri1.c) * (1.0 / 3.0) - cam).length();
-        double z2 = ((tri2.a + tri2.b + tri2.c) * (1.0 / 3.0) - cam).length();
-        return z1 > z2;
-    });
+    endStage(frameStats.cullTime, "cull");
 
-    // draw each projected triangle
-    for (const auto &tri : rasterizableTris) {
-        // project vertices onto a 2d plane
+    // sort triangles by depth. with the painter's algorithm we'll have visual bugs if triangles that are behind other
+    // triangles are rasterized first. with the depth buffer the depth test takes care of correctness, and drawing front
+    // to back just lets it reject hidden pixels before they're written. the keys were worked out while culling, so the
+    // sort itself doesn't touch the mesh
+    if (sortTriangles) rasterizableTris = radixSort(rasterizableTris, arena);
 
-        Vec2D projectedVert1 = getProjectedVector(tri.a, image, cam, camAngleX, camAngleY);
-        Vec2D projectedVert2 = getProjectedVector(tri.b, image, cam, camAngleX, camAngleY);
-        Vec2D projectedVert3 = getProjectedVector(tri.c, image, cam, camAngleX, camAngleY);
+    endStage(frameStats.sortTime, "sort");
 
-        projectedVert1.y *= 1;
-        projectedVert2.y *= 1;
-        projectedVert3.y *= 1;
+    // project every unique vertex once. the streams are the caller's, so they don't have to grow again every frame
+    VertexStreams &screen = scratch.screen;
+    projectVertices(view, mesh, screen);
+    endStage(frameStats.projectTime, "project");
 
-        fillTriangle(projectedVert1, projectedVert2, projectedVert3, tri.color, image);
+    // with a single hardware thread there's nothing to gain from binning
+    if (options.backend == RasterBackend::Tiled && getThreadPool().getThreadCount() > 1) {
+        rasterizeTiled(mesh, rasterizableTris, screen, target, pyramid, options.tileSize, arena, frameStats);
+        endStage(frameStats.drawTime, "draw");
+        if (stats) *stats += frameStats;
+        return;
     }
 
-}
-
-Vec3D computeMeshCenter(const Mesh& mesh) {
-    Vec3D weightedSum(0, 0, 0);
-    double totalArea = 0.0;
-
-    for (const auto& tri : mesh.surfaceTriangles) {
-        Vec3D edge1 = tri.b - tri.a;
-        Vec3D edge2 = tri.c - tri.a;
-        double area = edge1.cross(edge2).length() * 0.5;
-        Vec3D centroid = (tri.a + tri.b + tri.c) * (1.0 / 3.0);
-
-        weightedSum = weightedSum + (centroid * area);
-        totalArea += area;
-    }
-
-    // avoid runtime error
-    if (totalArea == 0.0) return Vec3D(0, 0, 0);
-
-    // find the weighted average
-    Vec3D meshCenter = weightedSum * (1.0 / totalArea);
-    return meshCenter;
-}
-
-// this works for relatively simple meshes and is dependent on all vectors from mesh's centroid to the triangles' centroids facing outwards (if the mesh centroid is outside of the mesh, this will not work)
-// typically mesh triangles are defined in the .txt files in the /inputs directory in such a way that their normals are facing outwards.
-// (this occurs when the triangle vertices are defined in counterclockwise order when looking directly at the triangle from outside the mesh)
-// but some input files do not follow this pattern, so this function ensures a mesh's triangle normals are oriented properly
-void ensureNormalsFaceOutward(Mesh& mesh) {
-    Vec3D meshCenter = computeMeshCenter(mesh);
-
-    for (auto& tri : mesh.surfaceTriangles) {
-
-        Vec3D normal = tri.normal;
-
-        // check for triangles wth 0 area (colinear vertices)
-        double area = normal.length() * 0.5;
-        if (area == 0.0) {
-            tri.normal = Vec3D(0, 0, 0);
+    // draw each projected triangle
+    for (const auto &tri : rasterizableTris) {
+        const uint32_t *corners = &mesh.indices[3 * static_cast<size_t>(tri.index)];
+        Vec3D projectedVert1 = getScreenVertex(screen, corners[0]);
+        Vec3D projectedVert2 = getScreenVertex(screen, corners[1]);
+        Vec3D projectedVert3 = getScreenVertex(screen, corners[2]);
+
+        TriangleSetup setup;
+        if (!setupTriangle(projectedVert1, projectedVert2, projectedVert3, target.width, target.height, setup)) continue;
+        if (!pyramid) {
+            drawTriangle(setup, setup.bounds, tri.color, target);
             continue;
         }
-        Vec3D centroid = (tri.a + tri.b + tri.c) * (1.0 / 3.0);
-
-        // vec from mesh center to triangle centroid
-        Vec3D toCentroid = centroid - meshCenter;
 
-        // check if the normal is pointing inward or outward
-        double dotProduct = normal.dot(toCentroid);
-        if (dotProduct < 0) normal = normal * (-1.0);
-
-        tri.normal = normal;
+        // skip triangles that are completely behind what's already been drawn
+        float nearest = static_cast<float>(std::max({projectedVert1.z, projectedVert2.z, projectedVert3.z}));
+        if (pyramid->isOccluded(setup.bounds, nearest, target.depth, target.pitch, pyramid->getLevelCount())) {
+            frameStats.hiZRejected++;
+            continue;
+        }
+        drawTriangle(setup, setup.bounds, tri.color, target);
+        pyramid->markDrawn(setup.bounds, pyramid->getLevelCount());
     }
-}
-
-
-
-
 
+    endStage(frameStats.drawTime, "draw");
+    if (stats) *stats += frameStats;
+}
@@ -4,38 +4,104 @@
 
 #ifndef GEOMETRY_H
 #define GEOMETRY_H
+#include <algorithm>
 #include <vector>
 #include "LinAlg.h"
+#include "DepthPyramid.h"
+#include "FrameArena.h"
+#include "Framebuffer.h"
+#include "Mesh.h"
+#include "RasterKernels.h"
 
 
-struct Triangle3D {
-    Vec3D a, b, c, normal;
-    mutable sf::Color color = sf::Color(255,255,255);
-    Triangle3D(Vec3D a, Vec3D b, Vec3D c) : a(a), b(b), c(c) {
-        normal = (b-a).cross(c-a);
-        normal = normal * (1.0/normal.length());
+enum class RasterBackend {
+    // draws every triangle in order on the calling thread
+    SingleThreaded,
+    // bins triangles into screen tiles and draws the tiles in parallel. produces the same image as SingleThreaded
+    Tiled
+};
+
+enum class DepthMode {
+    // sort triangles back to front and draw them over whatever is already there (painter's algorithm)
+    PainterSort,
+    // per pixel depth test against a depth buffer. no sorting, so intersecting and long triangles come out right
+    ZBuffer,
+    // depth buffer plus a front to back sort, so hidden pixels fail the depth test before anything is written
+    ZBufferFrontToBack
+};
+
+struct RenderOptions {
+    RasterBackend backend = RasterBackend::Tiled;
+    // tile width and height in pixels for the tiled backend
+    int tileSize = 64;
+    // the z buffer modes need a depth buffer to be passed to rasterizeMesh()
+    DepthMode depthMode = DepthMode::PainterSort;
+    // in the z buffer modes, skip triangles and meshes that are hidden according to the depth buffer's pyramid
+    bool hiZ = true;
+};
+
+// counters filled in by rasterizeMesh(), added up over all meshes drawn in a frame
+struct FrameStats {
+    size_t trianglesTotal = 0;
+    size_t backfaceCulled = 0;
+    // triangles that passed the backface test but were behind already drawn geometry according to the depth pyramid
+    size_t hiZRejected = 0;
+    // whole meshes skipped because their bounding box was hidden
+    size_t meshesHiZRejected = 0;
+    // milliseconds spent in each stage: backface culling and shading, sorting, projecting the vertices, and setting up,
+    // binning and filling the triangles
+    double cullTime = 0;
+    double sortTime = 0;
+    double projectTime = 0;
+    double drawTime = 0;
+
+    FrameStats &operator+=(const FrameStats &other) {
+        trianglesTotal += other.trianglesTotal;
+        backfaceCulled += other.backfaceCulled;
+        hiZRejected += other.hiZRejected;
+        meshesHiZRejected += other.meshesHiZRejected;
+        cullTime += other.cullTime;
+        sortTime += other.sortTime;
+        projectTime += other.projectTime;
+        drawTime += other.drawTime;
+        return *this;
     }
 };
 
-struct Mesh {
-    std::vector<Triangle3D> surfaceTriangles;
-    Vec3D center;
-    explicit Mesh(std::vector<Triangle3D> const &surfaceTriangles) : surfaceTriangles(surfaceTriangles) {};
-    void translate(const Vec3D &t) {
-        for (auto &tri : this->surfaceTriangles) {
-            tri.a = tri.a + t;
-            tri.b = tri.b + t;
-            tri.c = tri.c + t;
-        }
+// one float per pixel holding 1/depth of the closest surface drawn so far (0 means nothing has been drawn).
+// allocated once next to the framebuffer and cleared every frame
+struct DepthBuffer {
+    std::vector<float> values;
+    int width = 0, height = 0;
+    DepthPyramid pyramid;
+    void create(int w, int h) {
+        width = w;
+        height = h;
+        values.assign(static_cast<size_t>(w) * h, 0.0f);
+        pyramid.create(w, h);
+    }
+    void clear() {
+        std::fill(values.begin(), values.end(), 0.0f);
+        pyramid.clear();
     }
 };
 
-void rasterizeMesh(const Mesh &mesh, const Vec3D &cam, sf::Image &image, Vec3D lightSource, double camAngleX, double camAngleY);
+// memory rasterizeMesh() keeps from one call to the next so it doesn't have to allocate it again. every renderer owns
+// its own next to its depth buffer, so two of them drawing at the same time don't write over each other's
+struct RasterScratch {
+    // the mesh's vertices in screen space
+    VertexStreams screen;
+    // everything else that only lives while one mesh is drawn. reset at the start of every call
+    FrameArena arena;
+};
 
-inline void fillTriangle(const Vec2D &A, const Vec2D &B, const Vec2D &C, const sf::Color &color, sf::Image &image);
-#endif
+// view has to be built for the framebuffer's size. depthBuffer can be null in PainterSort mode. scratch can't be in
+// use by another call at the same time. if stats is set, this mesh's counters are added to it
+void rasterizeMesh(const Mesh &mesh, const ViewState &view, Framebuffer &framebuffer, DepthBuffer *depthBuffer, RasterScratch &scratch, Vec3D lightSource, const RenderOptions &options = RenderOptions(), FrameStats *stats = nullptr);
 
-void ensureNormalsFaceOutward(Mesh& mesh);
+// x and y of each vertex are screen coordinates, z is 1/depth (see getProjectedPoint())
+void fillTriangle(const Vec3D &A, const Vec3D &B, const Vec3D &C, const sf::Color &color, const RasterTarget &target);
+#endif
 
 
 
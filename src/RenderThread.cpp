@@ -0,0 +1,103 @@
+//
+// Created by Cooper Stevens on 3/18/25.
+//
+
+#include "RenderThread.h"
+
+#include "Profiler.h"
+#include "Tracer.h"
+
+RenderThread::RenderThread(std::vector<Mesh> meshes, int width, int height, const RenderOptions &options)
+    : meshes(std::move(meshes)), options(options) {
+    for (auto &framebuffer : framebuffers) framebuffer.create(width, height);
+    depthBuffer.create(width, height);
+    thread = std::thread(&RenderThread::renderLoop, this);
+}
+
+RenderThread::~RenderThread() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+void RenderThread::submit(const RenderRequest &request) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = request;
+        hasPending = true;
+    }
+    wake.notify_one();
+}
+
+bool RenderThread::acquireFrame(RenderedFrame &frame) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (ready < 0) return false;
+    // the frame shown until now goes back to the render thread
+    shown = ready;
+    ready = -1;
+    frame = readyFrame;
+    return true;
+}
+
+bool RenderThread::isBusy() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return hasPending || rendering || ready >= 0;
+}
+
+void RenderThread::waitForFrame(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex);
+    frameFinished.wait_for(lock, timeout, [this] { return ready >= 0 || (!hasPending && !rendering); });
+}
+
+FrameStats RenderThread::render(Framebuffer &framebuffer, const RenderRequest &request) {
+    {
+        PROFILE_SCOPE(ProfileStage::Clear);
+        framebuffer.clear(sf::Color::Magenta);
+        depthBuffer.clear();
+    }
+    // the projection only changes here, so it's built once for the whole frame
+    ViewState view(request.cameraPos, request.camAngleX, request.camAngleY, framebuffer.getWidth(), framebuffer.getHeight());
+    FrameStats frameStats;
+    for (const auto &mesh : meshes) {rasterizeMesh(mesh, view, framebuffer, &depthBuffer, scratch, request.lightSource, options, &frameStats);}
+
+    getProfiler().addFrameStats(frameStats);
+    if (request.drawHud) {
+        PROFILE_SCOPE(ProfileStage::Hud);
+        getProfiler().drawHud(framebuffer);
+    }
+    return frameStats;
+}
+
+void RenderThread::renderLoop() {
+    setTraceThreadName("render");
+    while (true) {
+        RenderRequest request;
+        int target = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || hasPending; });
+            if (stopping) return;
+            request = pending;
+            hasPending = false;
+            rendering = true;
+            // the one framebuffer that's neither on screen nor holding the newest finished frame
+            while (target == shown || target == ready) target++;
+        }
+
+        FrameStats frameStats = render(framebuffers[target], request);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            // a finished frame the main thread never picked up is simply replaced
+            rendering = false;
+            ready = target;
+            readyFrame.framebuffer = &framebuffers[target];
+            readyFrame.stats = frameStats;
+            readyFrame.number = ++frameCount;
+        }
+        frameFinished.notify_all();
+    }
+}
@@ -0,0 +1,90 @@
+//
+// Created by Cooper Stevens on 3/18/25.
+//
+
+#ifndef RENDERTHREAD_H
+#define RENDERTHREAD_H
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Framebuffer.h"
+#include "Rasterizer.h"
+
+// everything a frame depends on that changes while the program runs. copied into the render thread, so the main
+// thread can keep moving the camera while the frame is drawn
+struct RenderRequest {
+    Vec3D cameraPos;
+    double camAngleX = 0;
+    double camAngleY = 0;
+    Vec3D lightSource;
+    // draw the profiler's overlay on top
+    bool drawHud = false;
+};
+
+// a finished frame handed to the main thread
+struct RenderedFrame {
+    const Framebuffer *framebuffer = nullptr;
+    FrameStats stats;
+    // counts up from 1 with every frame the render thread finishes
+    uint64_t number = 0;
+};
+
+// draws frames on its own thread into a ring of three framebuffers, so a slow frame doesn't hold up input.
+// one framebuffer is being shown by the main thread, one holds the newest finished frame and the third is being drawn
+// into, so the next frame is rasterized while the last one is uploaded and displayed, and neither thread ever waits
+// for the other. requests that come in faster than frames can be drawn replace each other, only the newest is drawn
+class RenderThread {
+public:
+    static constexpr int FRAMEBUFFER_COUNT = 3;
+
+    RenderThread(std::vector<Mesh> meshes, int width, int height, const RenderOptions &options);
+    // finishes the frame being drawn, if any, and stops the thread
+    ~RenderThread();
+    RenderThread(const RenderThread &) = delete;
+    RenderThread &operator=(const RenderThread &) = delete;
+
+    // asks for a frame to be drawn
+    void submit(const RenderRequest &request);
+    // gets the newest finished frame if there's one that hasn't been acquired yet. its framebuffer isn't drawn into
+    // again until the next frame is acquired. returns false if nothing new has finished
+    bool acquireFrame(RenderedFrame &frame);
+    // true while a request is waiting, a frame is being drawn or a finished frame hasn't been acquired yet
+    bool isBusy();
+    // blocks until a finished frame can be acquired, nothing is left to draw, or timeout passes
+    void waitForFrame(std::chrono::milliseconds timeout);
+
+private:
+    void renderLoop();
+    // clears a framebuffer and draws one frame into it
+    FrameStats render(Framebuffer &framebuffer, const RenderRequest &request);
+
+    std::vector<Mesh> meshes;
+    RenderOptions options;
+    std::array<Framebuffer, FRAMEBUFFER_COUNT> framebuffers;
+    // only used by the render thread
+    DepthBuffer depthBuffer;
+    RasterScratch scratch;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable frameFinished;
+    bool stopping = false;
+    bool rendering = false;
+    RenderRequest pending;
+    bool hasPending = false;
+    // framebuffer indices, -1 for none
+    int ready = -1;
+    int shown = -1;
+    RenderedFrame readyFrame;
+    uint64_t frameCount = 0;
+
+    // started last, once everything above is set up
+    std::thread thread;
+};
+
+#endif
@@ -0,0 +1,79 @@
+//
+// Created by Cooper Stevens on 2/9/25.
+//
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <string>
+#include "Tracer.h"
+
+ThreadPool::ThreadPool(unsigned threadCount) {
+    for (unsigned i = 1; i < threadCount; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &worker : workers) worker.join();
+}
+
+void ThreadPool::run(size_t n, Task fn, void *ctx) {
+    // nothing to split
+    if (workers.empty() || n <= 1) {
+        for (size_t i = 0; i < n; i++) fn(ctx, i);
+        return;
+    }
+
+    std::lock_guard<std::mutex> runLock(runMutex);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = fn;
+        context = ctx;
+        count = n;
+        next.store(0, std::memory_order_relaxed);
+        busyWorkers = static_cast<unsigned>(workers.size());
+        generation++;
+    }
+    wake.notify_all();
+
+    runTask();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return busyWorkers == 0; });
+    task = nullptr;
+    context = nullptr;
+}
+
+void ThreadPool::workerLoop(unsigned index) {
+    setTraceThreadName("worker " + std::to_string(index));
+    uint64_t seen = 0;
+    while (true) {
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [&] { return stopping || generation != seen; });
+        if (stopping) return;
+        seen = generation;
+        lock.unlock();
+
+        runTask();
+
+        lock.lock();
+        if (--busyWorkers == 0) finished.notify_one();
+    }
+}
+
+void ThreadPool::runTask() {
+    for (size_t i = next.fetch_add(1, std::memory_order_relaxed); i < count; i = next.fetch_add(1, std::memory_order_relaxed)) {
+        task(context, i);
+    }
+}
+
+ThreadPool &getThreadPool() {
+    static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+    return pool;
+}
@@ -0,0 +1,68 @@
+//
+// Created by Cooper Stevens on 2/9/25.
+//
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// a fixed set of worker threads that split loops between them.
+// parallelFor hands out indices one at a time, so uneven work (like tiles with very different triangle counts) balances itself
+class ThreadPool {
+public:
+    // threadCount includes the thread calling parallelFor, so a pool of 1 runs everything inline
+    explicit ThreadPool(unsigned threadCount);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    unsigned getThreadCount() const {
+        return static_cast<unsigned>(workers.size()) + 1;
+    }
+
+    // calls fn(i) for every i in [0, count) spread across the pool and returns once all calls are done.
+    // the calling thread works too. fn isn't copied, so this doesn't allocate.
+    // not reentrant: fn must not call parallelFor on the same pool
+    template <typename F>
+    void parallelFor(size_t count, F &&fn) {
+        using Fn = std::remove_reference_t<F>;
+        run(count, [](void *context, size_t i) { (*static_cast<Fn *>(context))(i); }, const_cast<void *>(static_cast<const void *>(&fn)));
+    }
+
+private:
+    using Task = void (*)(void *, size_t);
+
+    void run(size_t count, Task task, void *context);
+    void workerLoop(unsigned index);
+    void runTask();
+
+    std::vector<std::thread> workers;
+    // only one loop runs at a time
+    std::mutex runMutex;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    bool stopping = false;
+    uint64_t generation = 0;
+    unsigned busyWorkers = 0;
+
+    // the loop currently being run
+    Task task = nullptr;
+    void *context = nullptr;
+    size_t count = 0;
+    std::atomic<size_t> next{0};
+};
+
+// shared pool with one thread per hardware thread
+ThreadPool &getThreadPool();
+
+#endif
@@ -0,0 +1,142 @@
+//
+// Created by Cooper Stevens on 3/17/25.
+//
+
+#include "Tracer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+// the calling thread's buffer and the name it'll get, set by setTraceThreadName()
+static thread_local void *threadBuffer = nullptr;
+static thread_local std::string threadName;
+
+Tracer::ThreadBuffer::~ThreadBuffer() {
+    for (Block *block = head; block;) {
+        Block *next = block->next.load(std::memory_order_relaxed);
+        delete block;
+        block = next;
+    }
+}
+
+static int64_t getNanoseconds(Tracer::Clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+void Tracer::startCapture() {
+#if RENDERER_PROFILING
+    captureStart.store(getNanoseconds(Clock::now()), std::memory_order_relaxed);
+    capture.fetch_add(1, std::memory_order_release);
+    capturing.store(true, std::memory_order_release);
+#endif
+}
+
+Tracer::ThreadBuffer *Tracer::getThreadBuffer() {
+    if (!threadBuffer) {
+        // the buffers outlive their threads, so a thread pool that shuts down mid capture doesn't lose its events
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        auto buffer = std::make_unique<ThreadBuffer>();
+        buffer->threadId = static_cast<uint32_t>(buffers.size()) + 1;
+        buffer->threadName = threadName.empty() ? "thread " + std::to_string(buffer->threadId) : threadName;
+        threadBuffer = buffer.get();
+        buffers.push_back(std::move(buffer));
+    }
+    return static_cast<ThreadBuffer *>(threadBuffer);
+}
+
+void Tracer::record(const char *name, Clock::time_point start, Clock::time_point end, int64_t argument) {
+    if (!isCapturing()) return;
+    ThreadBuffer &buffer = *getThreadBuffer();
+
+    // first event of a new capture on this thread
+    uint64_t currentCapture = capture.load(std::memory_order_acquire);
+    if (buffer.capture.load(std::memory_order_relaxed) != currentCapture) {
+        buffer.current = buffer.head;
+        buffer.count.store(0, std::memory_order_relaxed);
+        buffer.dropped.store(0, std::memory_order_relaxed);
+        buffer.capture.store(currentCapture, std::memory_order_release);
+    }
+
+    size_t index = buffer.count.load(std::memory_order_relaxed);
+    if (index == BLOCK_SIZE * MAX_BLOCKS) {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (index > 0 && index % BLOCK_SIZE == 0) {
+        // the blocks from earlier captures are reused before allocating new ones
+        Block *next = buffer.current->next.load(std::memory_order_relaxed);
+        if (!next) {
+            next = new Block;
+            buffer.current->next.store(next, std::memory_order_release);
+        }
+        buffer.current = next;
+    }
+
+    int64_t startTime = getNanoseconds(start) - captureStart.load(std::memory_order_relaxed);
+    buffer.current->events[index % BLOCK_SIZE] = {name, startTime, getNanoseconds(end) - getNanoseconds(start), argument};
+    buffer.count.store(index + 1, std::memory_order_release);
+}
+
+static void writeEscaped(std::ostream &out, const std::string &text) {
+    for (char c : text) {
+        if (c == '"' || c == '\\') out << '\\';
+        out << c;
+    }
+}
+
+bool Tracer::stopCapture(const std::string &filename) {
+    if (!isCapturing()) return false;
+    capturing.store(false, std::memory_order_release);
+    uint64_t stoppedCapture = capture.load(std::memory_order_acquire);
+
+    std::ofstream out(filename, std::ios::trunc);
+    if (!out.is_open()) return false;
+    // microseconds with nanosecond precision
+    out.setf(std::ios::fixed);
+    out.precision(3);
+
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    size_t eventCount = 0, dropped = 0;
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    out << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"RendererProject\"}}";
+    for (const auto &buffer : buffers) {
+        out << ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->threadId
+            << ", \"args\": {\"name\": \"";
+        writeEscaped(out, buffer->threadName);
+        out << "\"}}";
+        // sorts the main thread first, then the workers in order
+        out << ",\n{\"name\": \"thread_sort_index\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->threadId
+            << ", \"args\": {\"sort_index\": " << buffer->threadId << "}}";
+        if (buffer->capture.load(std::memory_order_acquire) != stoppedCapture) continue;
+
+        size_t count = buffer->count.load(std::memory_order_acquire);
+        dropped += buffer->dropped.load(std::memory_order_relaxed);
+        const Block *block = buffer->head;
+        for (size_t i = 0; i < count; i++) {
+            if (i > 0 && i % BLOCK_SIZE == 0) block = block->next.load(std::memory_order_acquire);
+            const TraceEvent &event = block->events[i % BLOCK_SIZE];
+            out << ",\n{\"name\": \"" << event.name << "\", \"cat\": \"renderer\", \"ph\": \"X\", \"pid\": 1, \"tid\": "
+                << buffer->threadId << ", \"ts\": " << std::max<int64_t>(event.start, 0) / 1000.0 << ", \"dur\": "
+                << event.duration / 1000.0;
+            if (event.argument >= 0) out << ", \"args\": {\"index\": " << event.argument << "}";
+            out << "}";
+        }
+        eventCount += count;
+    }
+    out << "\n], \"otherData\": {\"events\": " << eventCount << ", \"droppedEvents\": " << dropped << "}}\n";
+
+    if (dropped > 0) {
+        std::cerr << "trace buffers filled up, " << dropped << " events were dropped" << std::endl;
+    }
+    return static_cast<bool>(out);
+}
+
+Tracer &getTracer() {
+    static Tracer tracer;
+    return tracer;
+}
+
+void setTraceThreadName(const std::string &name) {
+    threadName = name;
+}
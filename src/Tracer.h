@@ -0,0 +1,130 @@
+//
+// Created by Cooper Stevens on 3/17/25.
+//
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// see Profiler.h, the same switch compiles the tracer out
+#ifndef RENDERER_PROFILING
+#define RENDERER_PROFILING 1
+#endif
+
+// one finished piece of work on one thread. name has to be a string literal (or live as long as the program), since
+// only the pointer is kept
+struct TraceEvent {
+    const char *name;
+    // nanoseconds since the capture started
+    int64_t start;
+    int64_t duration;
+    // shown in the viewer when it isn't negative, like the tile number of a rasterize-tile event
+    int64_t argument;
+};
+
+// records a timeline of what every thread was doing between startCapture() and stopCapture(), and writes it in the
+// chrome trace event format, which perfetto (ui.perfetto.dev) and about://tracing open.
+// every thread writes its events into its own buffer with no locks or shared counters, and nothing is written out
+// until the capture stops. a thread's buffer is created (under a lock) the first time it records something, and grows
+// in fixed blocks that are kept for the next capture
+class Tracer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // a thread stops recording after this many events in one capture, and the rest are counted as dropped
+    static constexpr size_t BLOCK_SIZE = 4096;
+    static constexpr size_t MAX_BLOCKS = 256;
+
+    // both can be called while other threads are recording. an event that's being recorded while the capture stops
+    // may be left out
+    void startCapture();
+    // stops recording and writes everything recorded since startCapture(). returns false if the file can't be written
+    bool stopCapture(const std::string &filename);
+
+    bool isCapturing() const {
+#if RENDERER_PROFILING
+        return capturing.load(std::memory_order_relaxed);
+#else
+        return false;
+#endif
+    }
+
+    // adds an event on the calling thread's track, if a capture is running
+    void record(const char *name, Clock::time_point start, Clock::time_point end, int64_t argument = -1);
+
+private:
+    struct Block {
+        TraceEvent events[BLOCK_SIZE];
+        // written once by the owning thread, read by stopCapture()
+        std::atomic<Block *> next = nullptr;
+    };
+
+    struct ThreadBuffer {
+        uint32_t threadId = 0;
+        std::string threadName;
+        Block *head = new Block;
+        // the block being filled. only the owning thread uses it
+        Block *current = head;
+        // the capture the events are from. the owning thread starts the buffer over when it sees a new one
+        std::atomic<uint64_t> capture = 0;
+        // events recorded in this capture, stored with release after each event is written so stopCapture() only
+        // reads complete events
+        std::atomic<size_t> count = 0;
+        std::atomic<size_t> dropped = 0;
+
+        ~ThreadBuffer();
+    };
+
+    ThreadBuffer *getThreadBuffer();
+
+    std::atomic<bool> capturing = false;
+    // which capture is running, so threads can tell their buffer is from an old one and start it over themselves
+    std::atomic<uint64_t> capture = 0;
+    std::atomic<int64_t> captureStart = 0;
+
+    // guards the list of buffers, which only changes when a thread records its first event
+    std::mutex buffersMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+};
+
+Tracer &getTracer();
+
+// names the calling thread's track in captures, like "main" or "worker 3"
+void setTraceThreadName(const std::string &name);
+
+// records the rest of the enclosing scope as an event. doesn't read the clock unless a capture is running
+class TraceScope {
+public:
+    explicit TraceScope(const char *name, int64_t argument = -1) : name(name), argument(argument), active(getTracer().isCapturing()) {
+        if (active) start = Tracer::Clock::now();
+    }
+    ~TraceScope() {
+        if (active) getTracer().record(name, start, Tracer::Clock::now(), argument);
+    }
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *name;
+    int64_t argument;
+    bool active;
+    Tracer::Clock::time_point start;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#if RENDERER_PROFILING
+// TRACE_SCOPE("name") or TRACE_SCOPE("name", number)
+#define TRACE_SCOPE(...) TraceScope TRACE_CONCAT(traceScope, __LINE__)(__VA_ARGS__)
+#else
+#define TRACE_SCOPE(...)
+#endif
+
+#endif
@@ -2,15 +2,34 @@
 #include <SFML/Graphics.hpp>
 #include <SFML/Window/Keyboard.hpp>
 #include <iostream>
+#include <chrono>
 #include <cmath>
+#include <cstdlib>
+#include <thread>
+#include "HeadlessRenderer.h"
 #include "InputHandler.h"
+#include "Profiler.h"
+#include "RenderThread.h"
+#include "Tracer.h"
 #include <filesystem>
 
 
 
 
 
-int main() {
+int main(int argc, char *argv[]) {
+    setTraceThreadName("main");
+
+    // with arguments, render one frame to a file without a window or any prompts (see --help)
+    if (argc > 1) {
+        HeadlessOptions options;
+        if (!parseHeadlessOptions(argc, argv, options)) return 1;
+        if (options.showHelp) {
+            printHeadlessUsage(argv[0]);
+            return 0;
+        }
+        return runHeadless(options);
+    }
 
     std::cout << "\n\n\n\n" << std::endl;
 
@@ -28,9 +47,25 @@ int main() {
                  "(LEFT ARROW: look left)\t"
                  "(RIGHT ARROW: look right)\t"
                  "(UP ARROW: look up)\t"
-                 "(DOWN ARROW: look down)\n\n\n");
+                 "(DOWN ARROW: look down)\n"
+                 "(F3: show frame timings)\t"
+                 "(F4: start/stop a trace capture)\n\n\n");
+
+    std::cout << "Rasterizing with the " << getCoverageKernelName() << " coverage kernel and the "
+              << getProjectionKernelName() << " projection kernel.\n";
+
 
 
+    // F4 starts and stops a timeline capture (see Tracer.h). with RENDERER_TRACE_JSON set, the first capture starts
+    // right away, so it includes loading the mesh, and every capture is written to that file instead of trace.json
+    const char *traceJson = std::getenv("RENDERER_TRACE_JSON");
+    std::string traceFile = traceJson ? traceJson : "trace.json";
+    Tracer &tracer = getTracer();
+    if (traceJson) tracer.startCapture();
+    auto stopTrace = [&] {
+        if (tracer.stopCapture(traceFile)) std::cout << "Wrote trace to " << traceFile << std::endl;
+        else std::cerr << "Can't write " << traceFile << std::endl;
+    };
 
     double camAngleX = 0;
     double camAngleY = 0;
@@ -46,43 +81,105 @@ int main() {
     double lookSpeed = getCamSpeed();
     if (lightFollowCamera) {lightSource = cameraPos;}
 
-    sf::Image image;
-    image.create(screenWidth, screenHeight);
-    for (unsigned int x = 0; x < screenWidth; ++x) {
-        for (unsigned int y = 0; y < screenHeight; ++y) {
-            image.setPixel(x, y, sf::Color::Magenta);
-        }
-    }
-
-    for (const auto& mesh : meshes) {rasterizeMesh(mesh, cameraPos, image, lightSource, camAngleY, camAngleY);}
+    RenderOptions renderOptions;
+    renderOptions.depthMode = DepthMode::ZBufferFrontToBack;
 
+    // created once at the window's size, after that every frame is a single upload into it
     sf::Texture texture;
-    if (!texture.loadFromImage(image)) {
-        std::cerr << "Can't load image" << std::endl;
+    if (!texture.create(screenWidth, screenHeight)) {
+        std::cerr << "Can't create texture" << std::endl;
         return -1;
     }
 
+    // F3 shows the profiler's stage times over the frame. with RENDERER_PROFILE_JSON set, the profiler also runs from
+    // the start and writes its summary to that file every few seconds
+    bool showHud = false;
+    bool forceRedraw = false;
+    const char *profileJson = std::getenv("RENDERER_PROFILE_JSON");
+    Profiler &profiler = getProfiler();
+    if (profileJson) profiler.setEnabled(true);
+    sf::Clock profileDumpClock;
+
     sf::Sprite sprite(texture);
     sf::RenderWindow window(sf::VideoMode(static_cast<unsigned int>(screenWidth),
                                       static_cast<unsigned int>(screenHeight)),
                         "Rendered Image");
 
+    // frames are drawn on their own thread (see RenderThread.h). this thread only handles input, hands the renderer
+    // a copy of the camera and light whenever they change, and shows whatever frame finished last
+    RenderThread renderer(std::move(meshes), screenWidth, screenHeight, renderOptions);
+    auto makeRequest = [&] {
+        RenderRequest request;
+        request.cameraPos = cameraPos;
+        request.camAngleX = camAngleX;
+        request.camAngleY = camAngleY;
+        request.lightSource = lightSource;
+        request.drawHud = showHud;
+        return request;
+    };
+    renderer.submit(makeRequest());
+
+    // while a key is held (or the hud is up) the loop runs at most this often. the rest of the time it sleeps until
+    // something happens instead of spinning
+    const int maxFrameRate = 120;
+    const auto frameBudget = std::chrono::microseconds(1000000 / maxFrameRate);
+    // whether the camera moved in the last cycle, and whether the window has to be drawn again
+    bool cameraChanged = false;
+    bool needsDisplay = true;
+
+    auto handleEvent = [&](const sf::Event &event) {
+        // Close the window if the close event is received
+        if (event.type == sf::Event::Closed)
+            window.close();
+        if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::F3) {
+            showHud = !showHud;
+            profiler.setEnabled(showHud || profileJson);
+            // redraw so the hud shows up or goes away even if the camera doesn't move
+            forceRedraw = true;
+        }
+        if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::F4) {
+            if (tracer.isCapturing()) stopTrace();
+            else tracer.startCapture();
+            // redraw so the capture has a frame in it even if the camera doesn't move
+            forceRedraw = true;
+        }
+        // the window's contents may have been lost
+        if (event.type == sf::Event::Resized || event.type == sf::Event::GainedFocus) needsDisplay = true;
+    };
 
     while (window.isOpen()) {
         if (lightFollowCamera) {lightSource = cameraPos;}
+        auto cycleStart = std::chrono::steady_clock::now();
 
         sf::Time deltaTime = clock.restart();
         double dt = deltaTime.asSeconds();
 
-        sf::Event event;
-        while (window.pollEvent(event)) {
-            // Close the window if the close event is received
-            if (event.type == sf::Event::Closed)
-                window.close();
+        // the previous iteration is over, dt is how long it took
+        profiler.addTime(ProfileStage::Frame, dt * 1000.0);
+        profiler.endFrame();
+        if (profileJson && profileDumpClock.getElapsedTime().asSeconds() >= 5.0f) {
+            if (!profiler.writeJson(profileJson)) std::cerr << "Can't write " << profileJson << std::endl;
+            profileDumpClock.restart();
+        }
+
+        // nothing is moving, being drawn or waiting to be shown, so block until the next event. the wait isn't
+        // movement time, so the clock starts over once something happens
+        if (!cameraChanged && !showHud && !forceRedraw && !needsDisplay && !renderer.isBusy()) {
+            sf::Event event;
+            if (window.waitEvent(event)) handleEvent(event);
+            clock.restart();
+            dt = 0;
+            cycleStart = std::chrono::steady_clock::now();
+        }
+
+        {
+            PROFILE_SCOPE(ProfileStage::Events);
+            sf::Event event;
+            while (window.pollEvent(event)) handleEvent(event);
         }
 
         //  check if the camera has moved
-        bool cameraChanged = false;
+        cameraChanged = false;
 
         // left
         if (sf::Keyboard::isKeyPressed(sf::Keyboard::A)) {
@@ -145,28 +242,44 @@ int main() {
             camAngleY += lookSpeed * dt;
             cameraChanged = true;
         }
-        // re-rasterize mesh and refresh the screen if camera has moved
-        if (cameraChanged) {
-            for (const auto& mesh : meshes) {rasterizeMesh(mesh, cameraPos, image, lightSource, camAngleX, camAngleY);}
+        // ask for a new frame if the camera has moved. the hud changes every frame, so while it's up every frame is
+        // drawn (which is also what you want to be measuring)
+        if (cameraChanged || showHud || forceRedraw) {
+            forceRedraw = false;
+            renderer.submit(makeRequest());
+        }
 
-            // update texture with newly-drawn image
-            if (!texture.loadFromImage(image)) {
-                std::cerr << "failed to load texture from image\n";
-            }
-            sprite.setTexture(texture, true);
+        // upload the newest finished frame, while the render thread is already drawing the next one
+        RenderedFrame frame;
+        if (renderer.acquireFrame(frame)) {
+            const FrameStats &frameStats = frame.stats;
+            window.setTitle("Rendered Image - " + std::to_string(frameStats.trianglesTotal) + " triangles, "
+                            + std::to_string(frameStats.backfaceCulled) + " backfacing, "
+                            + std::to_string(frameStats.hiZRejected) + " hidden (hi-z)");
+            PROFILE_SCOPE(ProfileStage::Upload);
+            frame.framebuffer->present(texture);
+            needsDisplay = true;
         }
 
-        // refresh window
-        for (int i = 0; i < screenWidth; ++i) {
-            for (int j = 0; j < screenHeight; ++j) {
-                image.setPixel(i, j, sf::Color::Magenta);
-            }
+        // refresh window, but only if there's something new on it
+        if (needsDisplay) {
+            PROFILE_SCOPE(ProfileStage::Present);
+            window.draw(sprite);
+            window.display();
+            needsDisplay = false;
         }
-        
-        window.draw(sprite);
-        window.display();
 
+        if (cameraChanged || showHud) {
+            // cap the frame rate while moving, rendering faster than the screen updates just burns power
+            auto elapsed = std::chrono::steady_clock::now() - cycleStart;
+            if (elapsed < frameBudget) std::this_thread::sleep_for(frameBudget - elapsed);
+        } else if (renderer.isBusy()) {
+            // the last frame is still being drawn. wait for it instead of polling, but keep handling input
+            renderer.waitForFrame(std::chrono::duration_cast<std::chrono::milliseconds>(frameBudget));
+        }
     }
 
+    if (profileJson) profiler.writeJson(profileJson);
+    if (tracer.isCapturing()) stopTrace();
     return 0;
 }